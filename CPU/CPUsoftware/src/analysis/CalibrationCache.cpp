@@ -0,0 +1,189 @@
+#include "CalibrationCache.h"
+
+/**
+ * constructor
+ * the calibration of the last run is read by Load()
+ */
+CalibrationCache::CalibrationCache() {
+
+  this->cache_file_name = CALIB_CACHE_FILE;
+  this->_flat_field.assign(N_OF_PIXEL_PER_PDM, 1.0f);
+  this->_background.assign(N_OF_PIXEL_PER_PDM, 0);
+  this->_gain_time = 0;
+  this->_n_updates = 0;
+}
+
+/**
+ * set the flat field from the result of an S-curve analysis
+ * @param sc_summary_packet result of ScurveAnalysis::Analyse() (not modified)
+ */
+int CalibrationCache::SetGains(SC_SUMMARY_PACKET * sc_summary_packet) {
+
+  /* distance from the pedestal to the 50% point of each pixel, and its median over the good pixels */
+  std::vector<float> distance(N_OF_PIXEL_PER_PDM);
+  std::vector<float> distances;
+  for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    distance[p] = sc_summary_packet->half_point[p] - sc_summary_packet->pedestal[p];
+    if (sc_summary_packet->flags[p] == SC_PIXEL_OK && distance[p] > 0) {
+      distances.push_back(distance[p]);
+    }
+  }
+  if (distances.size() < N_OF_PIXEL_PER_PDM / 2) {
+    clog << "error: " << logstream::error << "only " << distances.size() << " good pixels in the S-curve, gains not updated" << std::endl;
+    return 1;
+  }
+  std::nth_element(distances.begin(), distances.begin() + distances.size() / 2, distances.end());
+  const float inv_median = 1.0f / distances[distances.size() / 2];
+
+  std::vector<float> flat_field(N_OF_PIXEL_PER_PDM);
+  int n_bad = 0;
+  for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    float gain = distance[p] * inv_median;
+    bool good = (sc_summary_packet->flags[p] == SC_PIXEL_OK) && gain >= CALIB_GAIN_MIN && gain <= CALIB_GAIN_MAX;
+    flat_field[p] = good ? 1.0f / gain : 0.0f;
+    n_bad += !good;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(this->_m_calib);
+    this->_flat_field.swap(flat_field);
+    this->_gain_time = sc_summary_packet->sc_summary_time.cpu_time_stamp;
+  } /* release mutex */
+
+  clog << "info: " << logstream::info << "flat field updated from the S-curve, " << n_bad << " bad pixels" << std::endl;
+
+  return 0;
+}
+
+/**
+ * update the background with the D3 data of a ZYNQ_PACKET
+ * @param d3_sum sum of the D3 frames of each pixel, as in L4_PACKET::int_data
+ */
+int CalibrationCache::Update(const uint32_t * d3_sum) {
+
+  std::unique_lock<std::mutex> lock(this->_m_calib);
+  /* the first packet sets the background */
+  const float alpha = (this->_n_updates == 0) ? 1.0f : CALIB_BG_ALPHA;
+  float * background = this->_background.data();
+  for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    background[p] += alpha * (d3_sum[p] * (1.0f / N_OF_FRAMES_L3_V0) - background[p]);
+  }
+  this->_n_updates++;
+
+  return 0;
+}
+
+/**
+ * calibrate frames in the Zynq order, as (counts - background) x flat field
+ * @param frames n_frames frames of N_OF_PIXEL_PER_PDM pixels
+ * @param n_frames number of frames
+ * @param out n_frames x N_OF_PIXEL_PER_PDM calibrated values
+ * @param subtract_background if false, only the flat field is applied
+ */
+template <typename T>
+int CalibrationCache::Calibrate(const T * frames, int n_frames, float * out, bool subtract_background) {
+
+  std::unique_lock<std::mutex> lock(this->_m_calib);
+  const float * flat_field = this->_flat_field.data();
+  const float * background = this->_background.data();
+  const float bg_scale = subtract_background ? 1.0f : 0.0f;
+
+  for (int f = 0; f < n_frames; f++) {
+    const T * frame = frames + (long)f * N_OF_PIXEL_PER_PDM;
+    float * calibrated = out + (long)f * N_OF_PIXEL_PER_PDM;
+    for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+      calibrated[p] = ((float)frame[p] - bg_scale * background[p]) * flat_field[p];
+    }
+  }
+
+  return 0;
+}
+
+template int CalibrationCache::Calibrate<uint32_t>(const uint32_t *, int, float *, bool);
+template int CalibrationCache::Calibrate<float>(const float *, int, float *, bool);
+
+/**
+ * check if the flat field comes from an S-curve
+ */
+bool CalibrationCache::HasGains() {
+
+  std::unique_lock<std::mutex> lock(this->_m_calib);
+  return (this->_gain_time != 0);
+}
+
+/**
+ * check if the background has been measured
+ */
+bool CalibrationCache::HasBackground() {
+
+  std::unique_lock<std::mutex> lock(this->_m_calib);
+  return (this->_n_updates != 0);
+}
+
+/**
+ * save the cache to cache_file_name as a CALIB_PACKET
+ * a new file is written, then replaces the current one
+ */
+int CalibrationCache::Save() {
+
+  CALIB_PACKET * calib_packet = new CALIB_PACKET();
+  calib_packet->calib_packet_header.header = CpuTools::BuildCpuHeader(CALIB_PACKET_TYPE, CALIB_PACKET_VER);
+  calib_packet->calib_packet_header.pkt_size = sizeof(CALIB_PACKET);
+  calib_packet->calib_time.cpu_time_stamp = CpuTools::BuildCpuTimeStamp();
+  {
+    std::unique_lock<std::mutex> lock(this->_m_calib);
+    calib_packet->gain_time.cpu_time_stamp = this->_gain_time;
+    calib_packet->n_updates = this->_n_updates;
+    std::copy(this->_flat_field.begin(), this->_flat_field.end(), calib_packet->flat_field);
+    std::copy(this->_background.begin(), this->_background.end(), calib_packet->background);
+  } /* release mutex */
+
+  std::string tmp_file_name = this->cache_file_name + ".tmp";
+  FILE * cache_file = fopen(tmp_file_name.c_str(), "wb");
+  bool ok = (cache_file != NULL) && fwrite(calib_packet, sizeof(CALIB_PACKET), 1, cache_file) == 1;
+  if (cache_file != NULL) {
+    ok = (fclose(cache_file) == 0) && ok;
+  }
+  delete calib_packet;
+
+  if (!ok || std::rename(tmp_file_name.c_str(), this->cache_file_name.c_str()) != 0) {
+    clog << "error: " << logstream::error << "cannot update " << this->cache_file_name << std::endl;
+    std::remove(tmp_file_name.c_str());
+    return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * read the cache from cache_file_name
+ * returns 1 and keeps the current calibration if the file is missing or not valid
+ */
+int CalibrationCache::Load() {
+
+  FILE * cache_file = fopen(this->cache_file_name.c_str(), "rb");
+  if (cache_file == NULL) {
+    clog << "info: " << logstream::info << "no calibration cache in " << this->cache_file_name << std::endl;
+    return 1;
+  }
+
+  CALIB_PACKET * calib_packet = new CALIB_PACKET();
+  bool ok = fread(calib_packet, sizeof(CALIB_PACKET), 1, cache_file) == 1
+    && calib_packet->calib_packet_header.header == CpuTools::BuildCpuHeader(CALIB_PACKET_TYPE, CALIB_PACKET_VER)
+    && calib_packet->calib_packet_header.pkt_size == sizeof(CALIB_PACKET);
+  fclose(cache_file);
+
+  if (ok) {
+    std::unique_lock<std::mutex> lock(this->_m_calib);
+    this->_flat_field.assign(calib_packet->flat_field, calib_packet->flat_field + N_OF_PIXEL_PER_PDM);
+    this->_background.assign(calib_packet->background, calib_packet->background + N_OF_PIXEL_PER_PDM);
+    this->_gain_time = calib_packet->gain_time.cpu_time_stamp;
+    this->_n_updates = calib_packet->n_updates;
+  }
+  else {
+    clog << "error: " << logstream::error << "cannot read the calibration cache " << this->cache_file_name << std::endl;
+  }
+  delete calib_packet;
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#ifndef _CALIBRATION_CACHE_H
+#define _CALIBRATION_CACHE_H
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cmath>
+#include <mutex>
+#include <algorithm>
+
+#include "log.h"
+#include "CpuTools.h"
+#include "ConfigManager.h"
+#include "minieuso_data_format.h"
+
+/* file in which the calibration is kept between runs, in the STATE_DIR of the configuration */
+#define CALIB_CACHE_FILE_NAME "CalibrationCache.dat"
+#define CALIB_CACHE_FILE STATE_DIR "/" CALIB_CACHE_FILE_NAME
+/* weight of each new packet in the background, about 100 s of memory */
+#define CALIB_BG_ALPHA 0.05f
+/* range of the relative gain of a good pixel */
+#define CALIB_GAIN_MIN 0.2f
+#define CALIB_GAIN_MAX 5.0f
+
+/**
+ * per-pixel background and flat field, for the quick-look products.
+ * the relative gain of each pixel is the distance from the pedestal to the 50%
+ * point of its S-curve, which scales with the charge of the single photo-electron
+ * pulses, over the median of the PDM. pixels flagged by the S-curve analysis are set to 0.
+ * the detectors compare each pixel with its own background and fluctuations,
+ * which a gain does not change, and do not use the cache.
+ * the background is an exponential moving average of the mean D3 counts
+ * of each packet. the cache is saved to cache_file_name and read back by
+ * Load() at start up, so that no warm-up is needed after a restart
+ */
+class CalibrationCache {
+public:
+  /**
+   * file in which the cache is kept, CALIB_CACHE_FILE by default
+   */
+  std::string cache_file_name;
+
+  CalibrationCache();
+  int SetGains(SC_SUMMARY_PACKET * sc_summary_packet);
+  int Update(const uint32_t * d3_sum);
+  template <typename T>
+  int Calibrate(const T * frames, int n_frames, float * out, bool subtract_background);
+  bool HasGains();
+  bool HasBackground();
+  int Save();
+  int Load();
+
+private:
+  std::mutex _m_calib;
+  std::vector<float> _flat_field;
+  std::vector<float> _background;
+  uint32_t _gain_time;
+  uint32_t _n_updates;
+};
+
+#endif
+/* _CALIBRATION_CACHE_H */
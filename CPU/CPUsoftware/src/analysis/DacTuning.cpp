@@ -0,0 +1,132 @@
+#include "DacTuning.h"
+
+/**
+ * constructor
+ */
+DacTuning::DacTuning() {
+
+}
+
+/**
+ * compute the DAC10 threshold of each ASIC for a target noise rate
+ * @param sc_packet the S-curve read out from the Zynq (not modified)
+ * @param sc_summary_packet result of ScurveAnalysis::Analyse(), used to exclude bad pixels
+ * @param target_rate the maximum mean count rate per pixel in Hz
+ * returns N_DAC10 values in the dac10.txt order, or an empty vector on failure
+ */
+std::vector<int> DacTuning::ComputeDac10(SC_PACKET * sc_packet, SC_SUMMARY_PACKET * sc_summary_packet,
+					 int target_rate) {
+
+  std::vector<int> dac10_values;
+  const uint32_t n_thresholds = sc_packet->sc_data.size();
+  const int n_asic = N_DAC10;
+  int p = 0;
+
+  if (n_thresholds == 0 || sc_packet->sc_acc == 0 || target_rate <= 0) {
+    clog << "error: " << logstream::error << "cannot tune the DAC with " << n_thresholds
+	 << " thresholds, acc " << sc_packet->sc_acc << " and target rate " << target_rate << std::endl;
+    return dac10_values;
+  }
+
+  /* target in counts per pixel, as accumulated over sc_acc GTUs */
+  const float target_counts = target_rate * GTU_SEC * sc_packet->sc_acc;
+
+  /* weight of each pixel, 0 for pixels without a usable S-curve */
+  std::vector<float> weight(N_OF_PIXEL_PER_PDM);
+  std::vector<float> n_good(n_asic, 0);
+  for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    bool bad = sc_summary_packet->flags[p] & (SC_PIXEL_DEAD | SC_PIXEL_HOT | SC_PIXEL_NO_TRANSITION);
+    weight[p] = bad ? 0.0f : 1.0f;
+    n_good[p / N_OF_PIXELS_PER_PMT] += weight[p];
+  }
+
+  /* scan the thresholds upwards and keep the first one below target for each ASIC */
+  std::vector<int> threshold(n_asic, -1);
+  int n_pending = n_asic;
+  for (uint32_t i = 0; i < n_thresholds && n_pending > 0; i++) {
+
+    const uint32_t * row = sc_packet->sc_data[i].int32_data;
+    for (int a = 0; a < n_asic; a++) {
+
+      if (threshold[a] >= 0 || n_good[a] < DAC_TUNE_MIN_PIXELS) {
+	continue;
+      }
+
+      /* NB: contiguous block of 64 pixels, vectorised by the compiler */
+      const uint32_t * asic_row = row + a * N_OF_PIXELS_PER_PMT;
+      const float * asic_weight = weight.data() + a * N_OF_PIXELS_PER_PMT;
+      float sum = 0;
+      for (p = 0; p < N_OF_PIXELS_PER_PMT; p++) {
+	sum += asic_weight[p] * (float)(int32_t)asic_row[p];
+      }
+
+      if (sum <= target_counts * n_good[a]) {
+	threshold[a] = ScurveAnalysis::Threshold(sc_packet, i);
+	n_pending--;
+      }
+    }
+  }
+
+  /* ASICs which never reach the target are set to the top of the scan */
+  std::vector<int> tuned;
+  for (int a = 0; a < n_asic; a++) {
+    if (n_good[a] >= DAC_TUNE_MIN_PIXELS && threshold[a] < 0) {
+      clog << "error: " << logstream::error << "ASIC " << a << " is above " << target_rate
+	   << " Hz over the whole scan, set to " << sc_packet->sc_stop << std::endl;
+      threshold[a] = sc_packet->sc_stop;
+    }
+    if (threshold[a] >= 0) {
+      tuned.push_back(threshold[a]);
+    }
+  }
+
+  if (tuned.empty()) {
+    clog << "error: " << logstream::error << "no ASIC has enough good pixels to tune the DAC" << std::endl;
+    return dac10_values;
+  }
+
+  /* ASICs without enough good pixels follow the rest of the PDM */
+  int median = MedianDac10(tuned);
+  for (int a = 0; a < n_asic; a++) {
+    if (threshold[a] < 0) {
+      clog << "info: " << logstream::info << "ASIC " << a << " has too few good pixels, set to the median "
+	   << median << std::endl;
+      threshold[a] = median;
+    }
+  }
+
+  /* reorder as the dac10 matrix */
+  dac10_values.resize(n_asic);
+  for (int a = 0; a < n_asic; a++) {
+    dac10_values[Dac10Index(a / N_OF_PMT_PER_ECASIC, a % N_OF_PMT_PER_ECASIC)] = threshold[a];
+  }
+
+  return dac10_values;
+}
+
+/**
+ * index in the dac10 matrix of an ASIC
+ * @param ecasic the EC ASIC board, or slowctrl line, of the pixel data
+ * @param asic the ASIC on the board
+ * follows the ordering of ZynqManager::SetMatrixDac10(), where line = 5 - board
+ */
+int DacTuning::Dac10Index(int ecasic, int asic) {
+
+  int board = (N_OF_ECASIC_PER_PDM - 1) - ecasic;
+
+  return (asic * N_OF_ECASIC_PER_PDM) + board;
+}
+
+/**
+ * median of a set of DAC10 values, used to set the global DAC_LEVEL
+ */
+int DacTuning::MedianDac10(std::vector<int> dac10_values) {
+
+  if (dac10_values.empty()) {
+    return 0;
+  }
+
+  std::nth_element(dac10_values.begin(), dac10_values.begin() + dac10_values.size() / 2, dac10_values.end());
+
+  return dac10_values[dac10_values.size() / 2];
+}
@@ -0,0 +1,35 @@
+#ifndef _DAC_TUNING_H
+#define _DAC_TUNING_H
+
+#include <vector>
+#include <algorithm>
+
+#include "log.h"
+#include "ScurveAnalysis.h"
+#include "minieuso_data_format.h"
+
+/* duration of one GTU in seconds */
+#define GTU_SEC 2.5e-6
+/* number of ASICs and of values in the dac10 matrix */
+#define N_DAC10 (N_OF_ECASIC_PER_PDM * N_OF_PMT_PER_ECASIC)
+/* minimum number of good pixels for an ASIC to be tuned on its own */
+#define DAC_TUNE_MIN_PIXELS 8
+
+/**
+ * tuning of the ASIC DAC10 thresholds from an on-board S-curve.
+ * for each ASIC, the lowest threshold at which the mean count rate of its
+ * good pixels is at or below a target noise rate is chosen.
+ * the results are returned in the order of the dac10.txt matrix
+ * used by ZynqManager::SetMatrixDac10()
+ */
+class DacTuning {
+public:
+  DacTuning();
+  static std::vector<int> ComputeDac10(SC_PACKET * sc_packet, SC_SUMMARY_PACKET * sc_summary_packet,
+				       int target_rate);
+  static int Dac10Index(int ecasic, int asic);
+  static int MedianDac10(std::vector<int> dac10_values);
+};
+
+#endif
+/* _DAC_TUNING_H */
@@ -0,0 +1,73 @@
+#include "LightCurve.h"
+
+/**
+ * constructor
+ */
+LightCurve::LightCurve() {
+
+}
+
+/**
+ * extract the light curve of a ZYNQ_PACKET
+ * @param zynq_packet the packet read out from the Zynq (not modified)
+ * returns a new LC_PACKET
+ */
+LC_PACKET * LightCurve::Extract(ZYNQ_PACKET * zynq_packet) {
+
+  LC_PACKET * lc_packet = new LC_PACKET();
+  lc_packet->lc_packet_header.header = CpuTools::BuildCpuHeader(LC_PACKET_TYPE, LC_PACKET_VER);
+  lc_packet->lc_packet_header.pkt_size = sizeof(LC_PACKET);
+  lc_packet->lc_time.cpu_time_stamp = CpuTools::BuildCpuTimeStamp();
+  lc_packet->ts = zynq_packet->level3_data.payload.ts;
+  lc_packet->hv_status = zynq_packet->level3_data.payload.hv_status;
+
+  /* each PMT is a contiguous block of pixels, the PDM is the sum of the PMTs */
+  /* NB: a PMT cannot overflow 32 bits in one D3 frame */
+  for (int f = 0; f < N_OF_FRAMES_L3_V0; f++) {
+    const uint32_t * frame = zynq_packet->level3_data.payload.int32_data[f];
+    uint32_t * pmt_sum = lc_packet->pmt_sum[f];
+    uint64_t pdm_sum = 0;
+    for (int pmt = 0; pmt < N_OF_PMT_PER_PDM; pmt++) {
+      const uint32_t * pixels = frame + pmt * N_OF_PIXELS_PER_PMT;
+      uint32_t sum = 0;
+      for (int p = 0; p < N_OF_PIXELS_PER_PMT; p++) {
+	sum += pixels[p];
+      }
+      pmt_sum[pmt] = sum;
+      pdm_sum += sum;
+    }
+    lc_packet->pdm_sum[f] = pdm_sum;
+  }
+
+  return lc_packet;
+}
+
+/**
+ * integrate the D3 frames of a ZYNQ_PACKET into a single frame
+ * @param zynq_packet the packet read out from the Zynq (not modified)
+ * returns a new L4_PACKET
+ */
+L4_PACKET * LightCurve::Integrate(ZYNQ_PACKET * zynq_packet) {
+
+  L4_PACKET * l4_packet = new L4_PACKET();
+  l4_packet->l4_packet_header.header = CpuTools::BuildCpuHeader(L4_PACKET_TYPE, L4_PACKET_VER);
+  l4_packet->l4_packet_header.pkt_size = sizeof(L4_PACKET);
+  l4_packet->l4_time.cpu_time_stamp = CpuTools::BuildCpuTimeStamp();
+  l4_packet->ts = zynq_packet->level3_data.payload.ts;
+  l4_packet->trig_type = zynq_packet->level3_data.payload.trig_type;
+  memcpy(l4_packet->cathode_status, zynq_packet->level3_data.payload.cathode_status,
+	 sizeof(l4_packet->cathode_status));
+  l4_packet->hv_status = zynq_packet->level3_data.payload.hv_status;
+
+  /* frames outside and pixels inside, so that the sum is vectorised */
+  /* NB: 128 D3 frames of 8 bit counts cannot overflow 32 bits */
+  uint32_t * sum = l4_packet->int_data;
+  for (int f = 0; f < N_OF_FRAMES_L3_V0; f++) {
+    const uint32_t * frame = zynq_packet->level3_data.payload.int32_data[f];
+    for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+      sum[p] += frame[p];
+    }
+  }
+
+  return l4_packet;
+}
@@ -0,0 +1,25 @@
+#ifndef _LIGHT_CURVE_H
+#define _LIGHT_CURVE_H
+
+#include <cstring>
+
+#include "log.h"
+#include "CpuTools.h"
+#include "minieuso_data_format.h"
+
+/**
+ * light curve of the D3 data, for monitoring over a whole night.
+ * each D3 frame is reduced to the sum of the PDM and of each of the 36 PMTs,
+ * so that a packet of 128 frames gives a 128 x (1 + 36) time series.
+ * for the longer trends, the D3 frames of a packet are also integrated
+ * into a single frame of 5.24 s (L4)
+ */
+class LightCurve {
+public:
+  LightCurve();
+  static LC_PACKET * Extract(ZYNQ_PACKET * zynq_packet);
+  static L4_PACKET * Integrate(ZYNQ_PACKET * zynq_packet);
+};
+
+#endif
+/* _LIGHT_CURVE_H */
@@ -0,0 +1,89 @@
+#include "PacketStats.h"
+
+/**
+ * constructor
+ */
+PacketStats::PacketStats() {
+
+}
+
+/**
+ * compute the statistics of a ZYNQ_PACKET
+ * @param zynq_packet the packet read out from the Zynq (not modified)
+ * @param d3_sum sum of the D3 frames of each pixel, as in L4_PACKET::int_data
+ * returns a new STATS_PACKET
+ */
+STATS_PACKET * PacketStats::Compute(ZYNQ_PACKET * zynq_packet, const uint32_t * d3_sum) {
+
+  int p = 0;
+
+  STATS_PACKET * stats_packet = new STATS_PACKET();
+  stats_packet->stats_packet_header.header = CpuTools::BuildCpuHeader(STATS_PACKET_TYPE, STATS_PACKET_VER);
+  stats_packet->stats_packet_header.pkt_size = sizeof(STATS_PACKET);
+  stats_packet->stats_time.cpu_time_stamp = CpuTools::BuildCpuTimeStamp();
+  stats_packet->N1 = zynq_packet->level1_data.size();
+  stats_packet->N2 = zynq_packet->level2_data.size();
+
+  /* triggers */
+  for (auto & l1 : zynq_packet->level1_data) {
+    stats_packet->l1_trig_count[TrigIndex(l1.payload.trig_type)]++;
+  }
+  for (auto & l2 : zynq_packet->level2_data) {
+    stats_packet->l2_trig_count[TrigIndex(l2.payload.trig_type)]++;
+  }
+  stats_packet->l3_trig_type = zynq_packet->level3_data.payload.trig_type;
+  stats_packet->hv_status = zynq_packet->level3_data.payload.hv_status;
+  
+  /* D3 max of each pixel, frames outside and pixels inside */
+  uint32_t * d3_max = stats_packet->d3_max;
+  for (int f = 0; f < N_OF_FRAMES_L3_V0; f++) {
+    const uint32_t * frame = zynq_packet->level3_data.payload.int32_data[f];
+    for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+      d3_max[p] = std::max(d3_max[p], frame[p]);
+    }
+  }
+  const float norm = 1.0f / N_OF_FRAMES_L3_V0;
+  for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    stats_packet->d3_mean[p] = d3_sum[p] * norm;
+  }
+
+  /* PMT and ECASIC sums, each PMT is a contiguous block of pixels */
+  for (int pmt = 0; pmt < N_OF_ECASIC_PER_PDM * N_OF_PMT_PER_ECASIC; pmt++) {
+    uint64_t pmt_sum = 0;
+    for (p = pmt * N_OF_PIXELS_PER_PMT; p < (pmt + 1) * N_OF_PIXELS_PER_PMT; p++) {
+      pmt_sum += d3_sum[p];
+    }
+    stats_packet->pmt_sum[pmt] = pmt_sum;
+    stats_packet->ecasic_sum[pmt / N_OF_PMT_PER_ECASIC] += pmt_sum;
+  }
+
+  /* D1 saturation */
+  std::vector<uint16_t> n_saturated(N_OF_PIXEL_PER_PDM, 0);
+  for (auto & l1 : zynq_packet->level1_data) {
+    for (int f = 0; f < N_OF_FRAMES_L1_V0; f++) {
+      const uint8_t * frame = l1.payload.raw_data[f];
+      for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+	n_saturated[p] += (frame[p] >= D1_SATURATION);
+      }
+    }
+  }
+  for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    stats_packet->n_saturated_d1 += n_saturated[p];
+    stats_packet->n_saturated_pixels_d1 += (n_saturated[p] > 0);
+  }
+  
+  return stats_packet;
+}
+
+/**
+ * index of a trig_type in the STATS_PACKET counters
+ * unknown trig_types are counted as TRIG_OTHERS
+ */
+int PacketStats::TrigIndex(uint32_t trig_type) {
+
+  if (trig_type >= N_TRIG_TYPES) {
+    return TRIG_OTHERS;
+  }
+
+  return trig_type;
+}
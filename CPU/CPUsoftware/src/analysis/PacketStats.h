@@ -0,0 +1,27 @@
+#ifndef _PACKET_STATS_H
+#define _PACKET_STATS_H
+
+#include <vector>
+#include <algorithm>
+
+#include "log.h"
+#include "CpuTools.h"
+#include "minieuso_data_format.h"
+
+/**
+ * per-packet statistics of the Zynq data, for quick-look.
+ * counts the triggers by trig_type and reduces the D3 data to per-pixel,
+ * per-PMT and per-ECASIC quantities. the inner loops run over the pixels,
+ * which are contiguous in the Zynq data, so that they can be vectorised
+ */
+class PacketStats {
+public:
+  PacketStats();
+  static STATS_PACKET * Compute(ZYNQ_PACKET * zynq_packet, const uint32_t * d3_sum);
+
+private:
+  static int TrigIndex(uint32_t trig_type);
+};
+
+#endif
+/* _PACKET_STATS_H */
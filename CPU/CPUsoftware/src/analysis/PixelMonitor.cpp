@@ -0,0 +1,189 @@
+#include "PixelMonitor.h"
+
+/**
+ * constructor
+ */
+PixelMonitor::PixelMonitor() {
+
+  this->mask_file_name = AUTO_MASK_FILE;
+  Reset();
+}
+
+/**
+ * forget the statistics and the masked pixels
+ */
+void PixelMonitor::Reset() {
+
+  this->_mean.assign(N_OF_PIXEL_PER_PDM, 0);
+  this->_m2.assign(N_OF_PIXEL_PER_PDM, 0);
+  this->_n_outlier.assign(N_OF_PIXEL_PER_PDM, 0);
+  this->_masked.assign(N_OF_PIXEL_PER_PDM, 0);
+  this->_n_new = 0;
+  this->_start_time = time(NULL);
+  this->_written = false;
+}
+
+/**
+ * update the statistics with the D3 data of a ZYNQ_PACKET
+ * @param zynq_packet the packet read out from the Zynq (not modified)
+ * @param n_sigma a pixel is hot above the PDM median by n_sigma times the spread
+ * @param persist number of consecutive packets for which a pixel must be an outlier to be masked
+ * returns the number of pixels masked by this packet
+ */
+int PixelMonitor::Update(ZYNQ_PACKET * zynq_packet, float n_sigma, int persist) {
+
+  int p = 0;
+  float * mean = this->_mean.data();
+  float * m2 = this->_m2.data();
+
+  FrameStats(&zynq_packet->level3_data.payload.int32_data[0][0], mean, m2);
+
+  /* robust reference of the PDM: median, spread between pixels and typical fluctuation */
+  std::vector<float> values(this->_mean);
+  std::nth_element(values.begin(), values.begin() + N_OF_PIXEL_PER_PDM / 2, values.end());
+  const float median = values[N_OF_PIXEL_PER_PDM / 2];
+  for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    values[p] = std::fabs(mean[p] - median);
+  }
+  std::nth_element(values.begin(), values.begin() + N_OF_PIXEL_PER_PDM / 2, values.end());
+  const float spread = MAD_TO_SIGMA * values[N_OF_PIXEL_PER_PDM / 2];
+  for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    values[p] = m2[p];
+  }
+  std::nth_element(values.begin(), values.begin() + N_OF_PIXEL_PER_PDM / 2, values.end());
+  const float rms = std::sqrt(values[N_OF_PIXEL_PER_PDM / 2] / (N_OF_FRAMES_L3_V0 - 1));
+
+  /* hot pixels stand out of the PDM, dead pixels see nothing while the others do */
+  const float hot_limit = median + n_sigma * std::max(std::max(spread, rms), 1.0f);
+  const bool dead_check = (median >= PIXEL_DEAD_MIN_MEDIAN);
+  int n_masked = 0;
+  for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+
+    bool outlier = (mean[p] > hot_limit) || (dead_check && m2[p] == 0 && mean[p] == 0);
+    this->_n_outlier[p] = outlier ? this->_n_outlier[p] + 1 : 0;
+
+    /* NB: sources on the ground cross the field of view in a few packets */
+    if (!this->_masked[p] && persist > 0 && this->_n_outlier[p] >= persist) {
+      this->_masked[p] = 1;
+      n_masked++;
+      clog << "info: " << logstream::info << "pixel " << p << " (row " << PixelRow(p) << ", col " << PixelCol(p)
+	   << ") masked with mean " << mean[p] << " counts, PDM median " << median << std::endl;
+    }
+  }
+  this->_n_new += n_masked;
+
+  return n_masked;
+}
+
+/**
+ * mean and sum of squared deviations of each pixel over the D3 frames of a packet,
+ * with Welford's algorithm, frames outside and pixels inside
+ * @param d3 N_OF_FRAMES_L3_V0 frames of N_OF_PIXEL_PER_PDM pixels in the Zynq order
+ * @param mean N_OF_PIXEL_PER_PDM means
+ * @param m2 N_OF_PIXEL_PER_PDM sums of squared deviations, m2 / (N_OF_FRAMES_L3_V0 - 1) is the variance
+ */
+void PixelMonitor::FrameStats(const uint32_t * d3, float * mean, float * m2) {
+
+  for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    mean[p] = 0;
+    m2[p] = 0;
+  }
+  for (int f = 0; f < N_OF_FRAMES_L3_V0; f++) {
+    const uint32_t * frame = d3 + f * N_OF_PIXEL_PER_PDM;
+    const float inv_n = 1.0f / (f + 1);
+    for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+      float x = (float)(int32_t)frame[p];
+      float delta = x - mean[p];
+      mean[p] += delta * inv_n;
+      m2[p] += delta * (x - mean[p]);
+    }
+  }
+}
+
+/**
+ * write the pixels masked since the last Reset() to mask_file_name
+ * the file is replaced, so that a pixel found by an earlier run of the program
+ * is not masked again. it is written on the first call, even with no pixels
+ * returns 0 on success, or if there are no new pixels to write
+ */
+int PixelMonitor::WriteMask() {
+
+  if (this->_n_new == 0 && this->_written) {
+    return 0;
+  }
+  if (this->mask_file_name.empty()) {
+    clog << "error: " << logstream::error << "no file to write the pixel mask to" << std::endl;
+    return 1;
+  }
+
+  std::vector<std::vector<char>> matrix(MASK_SIZE, std::vector<char>(MASK_SIZE, '0'));
+  int n_masked = 0;
+  for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    if (this->_masked[p]) {
+      matrix[PixelRow(p)][PixelCol(p)] = '1';
+      n_masked++;
+    }
+  }
+
+  /* write a new file, then replace the current one */
+  std::string tmp_file_name = this->mask_file_name + ".tmp";
+  std::ofstream mask_file(tmp_file_name);
+  if (!mask_file.is_open()) {
+    clog << "error: " << logstream::error << "cannot open " << tmp_file_name << std::endl;
+    return 1;
+  }
+
+  char start_str[80];
+  char time_str[80];
+  time_t now = time(NULL);
+  strftime(start_str, sizeof(start_str), "%Y-%m-%d %H:%M:%S", gmtime(&this->_start_time));
+  strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", gmtime(&now));
+
+  mask_file << "/*****************************************************************" << std::endl;
+  mask_file << std::endl;
+  mask_file << "  written on board by PixelMonitor on " << time_str << " UTC" << std::endl;
+  mask_file << "  hot and dead pixels found in the D3 data since " << start_str << " UTC" << std::endl;
+  mask_file << "  applied together with DeadPixelMask.txt, replaced by each run of the program" << std::endl;
+  mask_file << "  same format as DeadPixelMask.txt:" << std::endl;
+  mask_file << "  each 8x8 sub-matrix is a (BOARD, ASIC), 1 is a dead pixel 0 is alive" << std::endl;
+  mask_file << std::endl;
+  mask_file << "*******************************************************************/" << std::endl;
+  mask_file << std::endl;
+  mask_file << "^ /*you need the symbol '^' to start and end the matrix" << std::endl;
+  mask_file << std::endl;
+  for (int row = 0; row < MASK_SIZE; row++) {
+    for (int col = 0; col < MASK_SIZE; col++) {
+      if (col > 0 && col % 8 == 0) {
+	mask_file << ((col % 16 == 0) ? "  " : " ");
+      }
+      mask_file << matrix[row][col];
+    }
+    mask_file << std::endl;
+    if (row % 16 == 15) {
+      mask_file << std::endl;
+    }
+  }
+  mask_file << "^ /* this is the end of matrix" << std::endl;
+  mask_file.close();
+
+  if (mask_file.fail() || std::rename(tmp_file_name.c_str(), this->mask_file_name.c_str()) != 0) {
+    clog << "error: " << logstream::error << "cannot update " << this->mask_file_name << std::endl;
+    std::remove(tmp_file_name.c_str());
+    return 1;
+  }
+
+  clog << "info: " << logstream::info << "added " << this->_n_new << " pixels to " << this->mask_file_name
+       << ", " << n_masked << " pixels masked" << std::endl;
+  this->_n_new = 0;
+  this->_written = true;
+
+  return 0;
+}
+
+/**
+ * number of pixels masked since the last Reset()
+ */
+int PixelMonitor::CountMasked() {
+
+  return std::count(this->_masked.begin(), this->_masked.end(), 1);
+}
@@ -0,0 +1,74 @@
+#ifndef _PIXEL_MONITOR_H
+#define _PIXEL_MONITOR_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <ctime>
+#include <algorithm>
+
+#include "log.h"
+#include "DeadPixelRead.h"
+#include "minieuso_data_format.h"
+
+/* size of the DeadPixelMask.txt matrix */
+#define MASK_SIZE FOCAL_SURFACE_SIZE
+/* scale of the median absolute deviation to a standard deviation */
+#define MAD_TO_SIGMA 1.4826f
+/* minimum median D3 counts per frame for a pixel with no counts to be dead */
+#define PIXEL_DEAD_MIN_MEDIAN 1.0f
+
+/**
+ * on-board detection of hot and dead pixels from the D3 data.
+ * the mean and variance of each pixel over the D3 frames of a packet are
+ * computed with Welford's algorithm, and the pixels which are outliers of
+ * the PDM for a number of consecutive packets are added to the mask.
+ * the mask is written in the DeadPixelMask.txt format to its own file,
+ * AUTO_MASK_FILE by default, so that it is applied together with the
+ * DeadPixelMask.txt of the operator by ZynqManager::HidePixels() at the next
+ * setup of the Zynq. the file only holds the pixels found by this run of the
+ * program, and DeadPixelMask.txt is never written
+ */
+class PixelMonitor {
+public:
+  /**
+   * file to which the mask is written
+   */
+  std::string mask_file_name;
+
+  PixelMonitor();
+  void Reset();
+  int Update(ZYNQ_PACKET * zynq_packet, float n_sigma, int persist);
+  static void FrameStats(const uint32_t * d3, float * mean, float * m2);
+  int WriteMask();
+  int CountMasked();
+
+private:
+  /**
+   * Welford mean and sum of squared deviations of each pixel over the D3 frames
+   */
+  std::vector<float> _mean;
+  std::vector<float> _m2;
+  /**
+   * number of consecutive packets for which each pixel is an outlier
+   */
+  std::vector<uint16_t> _n_outlier;
+  /**
+   * pixels to be masked
+   */
+  std::vector<uint8_t> _masked;
+  /**
+   * pixels masked since the last WriteMask(), and time of the last Reset()
+   */
+  int _n_new;
+  time_t _start_time;
+  /**
+   * true once the mask file was written since the last Reset()
+   */
+  bool _written;
+};
+
+#endif
+/* _PIXEL_MONITOR_H */
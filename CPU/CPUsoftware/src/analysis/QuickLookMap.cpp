@@ -0,0 +1,127 @@
+#include "QuickLookMap.h"
+
+/**
+ * constructor
+ */
+QuickLookMap::QuickLookMap() {
+
+  this->_n_run_frames = 0;
+}
+
+/**
+ * start the images of a new run
+ * @param main_file_name the CPU_RUN_MAIN file of the run, which gives the names of the images
+ */
+void QuickLookMap::Start(std::string main_file_name) {
+
+  this->_run_sum.assign(N_OF_PIXEL_PER_PDM, 0);
+  this->_n_run_frames = 0;
+
+  this->_run_file_name = main_file_name;
+  this->_run_file_name.replace(this->_run_file_name.rfind("CPU_RUN_MAIN"), 12, "CPU_RUN_MAP");
+  this->_run_file_name.replace(this->_run_file_name.length() - 4, 4, ".pgm");
+  this->_packets_file_name = this->_run_file_name;
+  this->_packets_file_name.replace(this->_packets_file_name.length() - 4, 4, "_packets.pgm");
+}
+
+/**
+ * integrate the D3 data of a ZYNQ_PACKET and append its image
+ * @param zynq_packet the packet read out from the Zynq (not modified)
+ * @param pkt_num of the CPU_PACKET, written in the image comment
+ * @param calib its flat field is applied if it has gains, can be NULL
+ */
+int QuickLookMap::Add(ZYNQ_PACKET * zynq_packet, const uint32_t * d3_sum, uint32_t pkt_num, CalibrationCache * calib) {
+
+  if (this->_run_file_name.empty()) {
+    return 1;
+  }
+
+  std::vector<float> mean(N_OF_PIXEL_PER_PDM);
+  for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    mean[p] = (float)d3_sum[p] / N_OF_FRAMES_L3_V0;
+    this->_run_sum[p] += d3_sum[p];
+  }
+  bool flat_fielded = (calib != NULL) && calib->HasGains();
+  if (flat_fielded) {
+    calib->Calibrate(mean.data(), 1, mean.data(), false);
+  }
+  std::vector<float> image(MASK_SIZE * MASK_SIZE);
+  PixelTransform::ToFocal(mean.data(), image.data());
+  this->_n_run_frames += N_OF_FRAMES_L3_V0;
+
+  std::string comment = "pkt_num " + std::to_string(pkt_num) + " unix_time "
+    + std::to_string(zynq_packet->level3_data.payload.ts.unix_time)
+    + (flat_fielded ? " flat fielded" : "") + " mean D3 counts per frame";
+
+  return WritePgm(this->_packets_file_name, image, comment, std::ios::app);
+}
+
+/**
+ * write the image of the whole run
+ * @param calib its flat field is applied if it has gains, can be NULL
+ */
+int QuickLookMap::Close(CalibrationCache * calib) {
+
+  if (this->_run_file_name.empty() || this->_n_run_frames == 0) {
+    return 1;
+  }
+
+  std::vector<float> mean(N_OF_PIXEL_PER_PDM);
+  for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    mean[p] = (float)((double)this->_run_sum[p] / this->_n_run_frames);
+  }
+  bool flat_fielded = (calib != NULL) && calib->HasGains();
+  if (flat_fielded) {
+    calib->Calibrate(mean.data(), 1, mean.data(), false);
+  }
+  std::vector<float> image(MASK_SIZE * MASK_SIZE);
+  PixelTransform::ToFocal(mean.data(), image.data());
+  std::string comment = "run of " + std::to_string(this->_n_run_frames / N_OF_FRAMES_L3_V0)
+    + " packets" + (flat_fielded ? " flat fielded" : "") + " mean D3 counts per frame";
+  int ret = WritePgm(this->_run_file_name, image, comment, std::ios::trunc);
+
+  this->_run_file_name = "";
+  return ret;
+}
+
+/**
+ * write a 48 x 48 binary PGM image
+ * @param file_name the image file
+ * @param image values in the order of DeadPixelMask.txt, rounded and limited to PGM_MAX_VAL
+ * @param comment written in the PGM header
+ * @param mode std::ios::app to add the image to the file, std::ios::trunc to replace it
+ * the maximum of the image is used as maxval, so that viewers stretch the contrast
+ */
+int QuickLookMap::WritePgm(std::string file_name, const std::vector<float> & image, std::string comment,
+			   std::ios_base::openmode mode) {
+
+  std::vector<uint16_t> values(image.size());
+  uint16_t max_val = 1;
+  for (size_t i = 0; i < image.size(); i++) {
+    values[i] = (uint16_t)std::min(std::round(image[i]), (float)PGM_MAX_VAL);
+    max_val = std::max(max_val, values[i]);
+  }
+
+  std::ofstream pgm_file(file_name, std::ios::out | std::ios::binary | mode);
+  if (!pgm_file.is_open()) {
+    clog << "error: " << logstream::error << "cannot open the file " << file_name << std::endl;
+    return 1;
+  }
+  pgm_file << "P5\n# " << comment << "\n" << MASK_SIZE << " " << MASK_SIZE << "\n" << max_val << "\n";
+
+  /* one byte per value below 256, else two bytes most significant first */
+  std::vector<uint8_t> raster;
+  for (auto value : values) {
+    if (max_val > 255) {
+      raster.push_back(value >> 8);
+    }
+    raster.push_back(value & 0xFF);
+  }
+  pgm_file.write((const char *)raster.data(), raster.size());
+  if (!pgm_file.good()) {
+    clog << "error: " << logstream::error << "cannot write to the file " << file_name << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
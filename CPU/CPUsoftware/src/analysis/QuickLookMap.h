@@ -0,0 +1,50 @@
+#ifndef _QUICK_LOOK_MAP_H
+#define _QUICK_LOOK_MAP_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+
+#include "log.h"
+#include "PixelMonitor.h"
+#include "PixelTransform.h"
+#include "CalibrationCache.h"
+#include "minieuso_data_format.h"
+
+/* largest value of a 16 bit PGM image */
+#define PGM_MAX_VAL 65535
+
+/**
+ * quick-look images of the focal surface, for a picture of each run
+ * without downloading the CPU_RUN_MAIN file.
+ * the D3 frames of each packet are integrated and mapped onto the 48 x 48
+ * focal surface, as in DeadPixelMask.txt. the image of each packet is appended
+ * to a CPU_RUN_MAP__<date>_packets.pgm file, and the image of the whole run
+ * is written to CPU_RUN_MAP__<date>.pgm when the run is closed.
+ * the pixel values are the mean D3 counts per frame, flat fielded once the
+ * gains are known from an S-curve
+ */
+class QuickLookMap {
+public:
+  QuickLookMap();
+  void Start(std::string main_file_name);
+  int Add(ZYNQ_PACKET * zynq_packet, const uint32_t * d3_sum, uint32_t pkt_num, CalibrationCache * calib);
+  int Close(CalibrationCache * calib);
+
+private:
+  /**
+   * sum of the D3 counts of the run, in the Zynq order
+   */
+  std::vector<uint64_t> _run_sum;
+  long _n_run_frames;
+  std::string _run_file_name;
+  std::string _packets_file_name;
+
+  static int WritePgm(std::string file_name, const std::vector<float> & image, std::string comment,
+		      std::ios_base::openmode mode);
+};
+
+#endif
+/* _QUICK_LOOK_MAP_H */
@@ -0,0 +1,165 @@
+#include "RateMonitor.h"
+
+/**
+ * constructor
+ */
+RateMonitor::RateMonitor() {
+
+  this->_zynq = NULL;
+  this->_log_step = 0;
+  this->_action = RATE_LOG_ONLY;
+}
+
+/**
+ * destructor
+ */
+RateMonitor::~RateMonitor() {
+
+  Stop();
+}
+
+/**
+ * reset the baselines for a new acquisition
+ * @param Zynq the Zynq interface used by the action, can be NULL
+ * @param step_factor a step multiplies or divides the rate by at least this factor, <= 1 to disable the monitor
+ * @param action the RateAction taken on a rising step
+ */
+void RateMonitor::Start(ZynqManager * Zynq, float step_factor, int action) {
+
+  this->_zynq = Zynq;
+  this->_log_step = (step_factor > 1) ? std::log(step_factor) : 0;
+  this->_action = action;
+  this->_baseline.assign(N_OF_ECASIC_PER_PDM, 0);
+  this->_n_away.assign(N_OF_ECASIC_PER_PDM, 0);
+  this->_acted.assign(N_EC, 0);
+}
+
+/**
+ * wait for the last action to complete
+ */
+void RateMonitor::Stop() {
+
+  if (this->_action_done.valid()) {
+    this->_action_done.wait();
+  }
+}
+
+/**
+ * look for steps in the D3 rate of each ECASIC of a packet
+ * @param zynq_packet the packet read out from the Zynq (not modified)
+ * @param pkt_num of the CPU_PACKET, for the log
+ * returns the number of steps found
+ */
+int RateMonitor::Update(ZYNQ_PACKET * zynq_packet, uint32_t pkt_num) {
+
+  if (this->_log_step <= 0 || this->_baseline.empty()) {
+    return 0;
+  }
+
+  int n_steps = 0;
+  std::vector<int> ec_mask(N_EC, 0);
+  bool act = false;
+
+  for (int f = 0; f < N_OF_FRAMES_L3_V0; f++) {
+    const uint32_t * frame = zynq_packet->level3_data.payload.int32_data[f];
+
+    for (int e = 0; e < N_OF_ECASIC_PER_PDM; e++) {
+
+      /* the pixels of an ECASIC are contiguous */
+      const uint32_t * pixels = frame + e * N_OF_PIXELS_PER_ECASIC;
+      uint64_t sum = 0;
+      for (int p = 0; p < N_OF_PIXELS_PER_ECASIC; p++) {
+	sum += pixels[p];
+      }
+      double rate = sum;
+      double & baseline = this->_baseline[e];
+      int & n_away = this->_n_away[e];
+
+      /* first frame of the acquisition */
+      if (baseline <= 0) {
+	baseline = std::max(rate, 1.0);
+	continue;
+      }
+
+      /* away from the baseline both in significance and in ratio */
+      double sigma = std::sqrt(baseline);
+      double log_ratio = std::log((rate + 1) / (baseline + 1));
+      int away = 0;
+      if (std::fabs(rate - baseline) > RATE_N_SIGMA * sigma && std::fabs(log_ratio) >= this->_log_step) {
+	away = (rate > baseline) ? 1 : -1;
+      }
+
+      if (away == 0) {
+	n_away = 0;
+	baseline += RATE_BG_ALPHA * (rate - baseline);
+	continue;
+      }
+      n_away = (n_away * away > 0) ? n_away + away : away;
+      if (std::abs(n_away) < RATE_STEP_FRAMES) {
+	continue;
+      }
+
+      /* a step, the new rate is the baseline from now on */
+      n_steps++;
+      clog << "info: " << logstream::info << "rate step " << ((away > 0) ? "up" : "down")
+	   << " on ECASIC " << e << " in packet " << pkt_num << " at D3 frame " << f - RATE_STEP_FRAMES + 1
+	   << ": " << (long)baseline << " -> " << (long)rate << " counts per frame" << std::endl;
+      baseline = std::max(rate, 1.0);
+      n_away = 0;
+
+      if (away > 0 && this->_action != RATE_LOG_ONLY) {
+	std::vector<int> ecs = EcMask(e);
+	for (int i = 0; i < N_EC; i++) {
+	  if (ecs[i] && !this->_acted[i]) {
+	    ec_mask[i] = 1;
+	    this->_acted[i] = 1;
+	    act = true;
+	  }
+	}
+      }
+    }
+  }
+
+  /* the EC units are only acted on once */
+  if (act && this->_zynq != NULL) {
+    this->_action_done = this->_zynq->Submit<int>([this, ec_mask]() { return Act(ec_mask); },
+						  ZynqManager::LANE_URGENT);
+  }
+
+  return n_steps;
+}
+
+/**
+ * EC units covering an ECASIC
+ * the ECASIC gives the row of PMTs, and an EC unit is a square of 2 x 2 PMTs,
+ * numbered row major like the PMTs
+ * @param ecasic the ECASIC
+ * returns a vector of N_EC values, 1 for the EC units of the ECASIC
+ */
+std::vector<int> RateMonitor::EcMask(int ecasic) {
+
+  const int ec_size = 2; /* PMTs */
+  const int ec_per_row = N_OF_PMT_PER_ECASIC / ec_size;
+  std::vector<int> ec_mask(N_EC, 0);
+  for (int i = 0; i < ec_per_row; i++) {
+    ec_mask[(ecasic / ec_size) * ec_per_row + i] = 1;
+  }
+
+  return ec_mask;
+}
+
+/**
+ * take the action on some EC units, on the Zynq I/O thread
+ * @param ec_mask vector of N_EC values, 1 for the EC units to act on
+ */
+int RateMonitor::Act(std::vector<int> ec_mask) {
+
+  switch (this->_action) {
+  case RATE_LOWER_GAIN:
+    return this->_zynq->HvpsLowerDac(ec_mask, RATE_DAC_STEP);
+  case RATE_EC_OFF:
+    return this->_zynq->HvpsTurnOffEc(ec_mask);
+  default:
+    return 0;
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef _RATE_MONITOR_H
+#define _RATE_MONITOR_H
+
+#include <vector>
+#include <future>
+#include <cmath>
+#include <algorithm>
+
+#include "log.h"
+#include "ZynqManager.h"
+#include "minieuso_data_format.h"
+
+/* weight of each D3 frame in the baseline rate of an ECASIC */
+#define RATE_BG_ALPHA 0.01f
+/* a step is at least this many times the Poisson fluctuation of the baseline */
+#define RATE_N_SIGMA 5.0f
+/* number of consecutive D3 frames away from the baseline for a step */
+#define RATE_STEP_FRAMES 3
+/* HV DAC removed from the dynode voltage of the EC units by RATE_LOWER_GAIN */
+#define RATE_DAC_STEP 500
+/* number of pixels of an ECASIC */
+#define N_OF_PIXELS_PER_ECASIC (N_OF_PMT_PER_ECASIC * N_OF_PIXELS_PER_PMT)
+
+/**
+ * streaming monitor of the D3 count rate of each ECASIC, to detect the
+ * sudden brightness changes of lightning, city lights or a PMT fault.
+ * the rate of each ECASIC in each D3 frame is compared to its baseline, and a
+ * step is found when it stays above or below by RATE_STEP_FACTOR for
+ * RATE_STEP_FRAMES frames, so within the packet in which it happens.
+ * each step is logged, and a rising step can trigger a ZynqManager action on
+ * the EC units behind the ECASIC, queued ahead of the other Zynq commands
+ * without waiting for it, so that it does not delay the ingest of the packets
+ */
+class RateMonitor {
+public:
+  /**
+   * action on a rising step, set by RATE_ACTION
+   */
+  enum RateAction : uint8_t {
+    RATE_LOG_ONLY = 0,
+    RATE_LOWER_GAIN = 1,
+    RATE_EC_OFF = 2,
+  };
+
+  RateMonitor();
+  ~RateMonitor();
+  void Start(ZynqManager * Zynq, float step_factor, int action);
+  void Stop();
+  int Update(ZYNQ_PACKET * zynq_packet, uint32_t pkt_num);
+  static std::vector<int> EcMask(int ecasic);
+
+private:
+  ZynqManager * _zynq;
+  float _log_step;
+  int _action;
+  /**
+   * baseline rate of each ECASIC, in counts per D3 frame, 0 before the first packet
+   */
+  std::vector<double> _baseline;
+  /**
+   * signed number of consecutive frames above (> 0) or below (< 0) the baseline
+   */
+  std::vector<int> _n_away;
+  /**
+   * EC units on which the action has already been taken since Start()
+   */
+  std::vector<int> _acted;
+  std::shared_future<int> _action_done;
+
+  int Act(std::vector<int> ec_mask);
+};
+
+#endif
+/* _RATE_MONITOR_H */
@@ -0,0 +1,234 @@
+#include "ScurveAnalysis.h"
+
+/**
+ * constructor
+ */
+ScurveAnalysis::ScurveAnalysis() {
+
+}
+
+/**
+ * analyse the S-curves of all pixels in an SC_PACKET
+ * @param sc_packet the S-curve read out from the Zynq (not modified)
+ * returns a new SC_SUMMARY_PACKET, or NULL if the packet is too short to analyse
+ */
+SC_SUMMARY_PACKET * ScurveAnalysis::Analyse(SC_PACKET * sc_packet) {
+
+  const uint32_t n_thresholds = sc_packet->sc_data.size();
+  int p = 0;
+
+  if (n_thresholds < 2) {
+    clog << "error: " << logstream::error << "cannot analyse an S-curve with " << n_thresholds << " thresholds" << std::endl;
+    return NULL;
+  }
+
+  SC_SUMMARY_PACKET * sc_summary_packet = new SC_SUMMARY_PACKET();
+  sc_summary_packet->sc_summary_packet_header.header = CpuTools::BuildCpuHeader(SC_SUMMARY_PACKET_TYPE, SC_SUMMARY_PACKET_VER);
+  sc_summary_packet->sc_summary_packet_header.pkt_size = sizeof(SC_SUMMARY_PACKET);
+  sc_summary_packet->sc_summary_time.cpu_time_stamp = CpuTools::BuildCpuTimeStamp();
+  sc_summary_packet->sc_start = sc_packet->sc_start;
+  sc_summary_packet->sc_step = sc_packet->sc_step;
+  sc_summary_packet->sc_stop = sc_packet->sc_stop;
+  sc_summary_packet->sc_acc = sc_packet->sc_acc;
+
+  /* per pixel accumulators */
+  std::vector<float> sign(N_OF_PIXEL_PER_PDM);
+  std::vector<float> s0(N_OF_PIXEL_PER_PDM, 0);
+  std::vector<float> s1(N_OF_PIXEL_PER_PDM, 0);
+  std::vector<float> s2(N_OF_PIXEL_PER_PDM, 0);
+  std::vector<float> slope_max(N_OF_PIXEL_PER_PDM, 0);
+  std::vector<float> x_max(N_OF_PIXEL_PER_PDM, 0);
+  std::vector<float> c_max(N_OF_PIXEL_PER_PDM, 0);
+  std::vector<float> plateau(N_OF_PIXEL_PER_PDM);
+
+  /* counts usually fall with the threshold, but allow for rising S-curves */
+  /* NB: counts are cast through int32_t as they never reach 2^31 and this vectorises */
+  const uint32_t * first = sc_packet->sc_data[0].int32_data;
+  const uint32_t * last = sc_packet->sc_data[n_thresholds - 1].int32_data;
+  for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    float c_first = (float)(int32_t)first[p];
+    float c_last = (float)(int32_t)last[p];
+    sign[p] = (c_first >= c_last) ? 1.0f : -1.0f;
+    plateau[p] = (c_first >= c_last) ? c_last : c_first;
+    c_max[p] = std::max(c_first, c_last);
+  }
+
+  /* moments of the derivative in DAC above the first threshold, thresholds outside and pixels inside */
+  /* NB: the thresholds need not be evenly spaced */
+  const float t_0 = Threshold(sc_packet, 0);
+  for (uint32_t i = 0; i < n_thresholds - 1; i++) {
+
+    const uint32_t * a = sc_packet->sc_data[i].int32_data;
+    const uint32_t * b = sc_packet->sc_data[i + 1].int32_data;
+    const float t_a = Threshold(sc_packet, i);
+    const float t_b = Threshold(sc_packet, i + 1);
+    const float x = 0.5f * (t_a + t_b) - t_0;
+    const float inv_dt = (t_b > t_a) ? 1.0f / (t_b - t_a) : 0.0f;
+
+    for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+      float c_a = (float)(int32_t)a[p];
+      float d = sign[p] * (c_a - (float)(int32_t)b[p]);
+      s0[p] += d;
+      s1[p] += x * d;
+      s2[p] += x * x * d;
+      bool steeper = d * inv_dt > slope_max[p];
+      slope_max[p] = steeper ? d * inv_dt : slope_max[p];
+      x_max[p] = steeper ? x : x_max[p];
+      c_max[p] = std::max(c_max[p], c_a);
+    }
+  }
+
+  for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    float norm = (s0[p] > 0) ? 1.0f / s0[p] : 0.0f;
+    float mean = s1[p] * norm;
+    float var = s2[p] * norm - mean * mean;
+    sc_summary_packet->half_point[p] = t_0 + mean;
+    sc_summary_packet->width[p] = std::sqrt(std::max(var, 0.0f));
+    sc_summary_packet->pedestal[p] = t_0 + x_max[p];
+  }
+
+  /* flag the outliers */
+  float plateau_median = Median(plateau);
+  float hot_limit = SC_HOT_FACTOR * plateau_median + SC_HOT_MIN_COUNTS;
+  float edge_low = Threshold(sc_packet, 1);
+  float edge_high = Threshold(sc_packet, n_thresholds - 2);
+  for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+
+    uint8_t flag = SC_PIXEL_OK;
+    float mean = sc_summary_packet->half_point[p];
+
+    if (c_max[p] == 0) {
+      flag |= SC_PIXEL_DEAD;
+    }
+    else if (s0[p] < SC_MIN_TRANSITION) {
+      flag |= SC_PIXEL_NO_TRANSITION;
+    }
+    else if (mean < edge_low || mean > edge_high) {
+      flag |= SC_PIXEL_EDGE;
+    }
+    if (plateau[p] > hot_limit) {
+      flag |= SC_PIXEL_HOT;
+    }
+
+    /* no meaningful results without a transition */
+    if (flag & (SC_PIXEL_DEAD | SC_PIXEL_NO_TRANSITION)) {
+      sc_summary_packet->half_point[p] = 0;
+      sc_summary_packet->width[p] = 0;
+      sc_summary_packet->pedestal[p] = 0;
+    }
+    sc_summary_packet->flags[p] = flag;
+  }
+
+  return sc_summary_packet;
+}
+
+/**
+ * find the threshold windows which contain the transitions of the pixels
+ * @param sc_summary_packet result of ScurveAnalysis::Analyse()
+ * @param n_sigma half size of the window around the 50% point of each pixel, in units of the width
+ * @param min_gap windows separated by less than min_gap DAC are merged
+ * returns the sorted, non-overlapping [low, high] windows in DAC, one per group of ASICs
+ */
+std::vector<std::pair<int, int>> ScurveAnalysis::TransitionWindows(SC_SUMMARY_PACKET * sc_summary_packet,
+								  float n_sigma, int min_gap) {
+
+  std::vector<std::pair<int, int>> windows;
+
+  /* one window per ASIC, over its pixels with a transition */
+  for (int p0 = 0; p0 < N_OF_PIXEL_PER_PDM; p0 += N_OF_PIXELS_PER_PMT) {
+
+    float low = 0, high = 0;
+    bool found = false;
+    for (int p = p0; p < p0 + N_OF_PIXELS_PER_PMT; p++) {
+
+      if (sc_summary_packet->flags[p] & (SC_PIXEL_DEAD | SC_PIXEL_HOT | SC_PIXEL_NO_TRANSITION)) {
+	continue;
+      }
+      float half_size = n_sigma * sc_summary_packet->width[p];
+      float l = sc_summary_packet->half_point[p] - half_size;
+      float h = sc_summary_packet->half_point[p] + half_size;
+      low = found ? std::min(low, l) : l;
+      high = found ? std::max(high, h) : h;
+      found = true;
+    }
+    if (found) {
+      windows.push_back(std::make_pair((int)std::floor(low), (int)std::ceil(high)));
+    }
+  }
+
+  /* merge the overlapping windows */
+  std::sort(windows.begin(), windows.end());
+  std::vector<std::pair<int, int>> merged;
+  for (auto & w : windows) {
+    if (!merged.empty() && w.first <= merged.back().second + min_gap) {
+      merged.back().second = std::max(merged.back().second, w.second);
+    }
+    else {
+      merged.push_back(w);
+    }
+  }
+
+  return merged;
+}
+
+/**
+ * threshold in DAC of a row of an SC_PACKET
+ * @param sc_packet the S-curve
+ * @param i the row
+ * uses the uniform scan when the thresholds are not listed
+ */
+float ScurveAnalysis::Threshold(SC_PACKET * sc_packet, uint32_t i) {
+
+  if (i < sc_packet->sc_thresholds.size()) {
+    return sc_packet->sc_thresholds[i];
+  }
+
+  return sc_packet->sc_start + i * sc_packet->sc_step;
+}
+
+/**
+ * count the pixels with a given flag
+ * @param sc_summary_packet result of ScurveAnalysis::Analyse()
+ * @param flag one or more SC_PIXEL_XXX flags
+ */
+int ScurveAnalysis::CountFlagged(SC_SUMMARY_PACKET * sc_summary_packet, uint8_t flag) {
+
+  int n_flagged = 0;
+  for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    if (sc_summary_packet->flags[p] & flag) {
+      n_flagged++;
+    }
+  }
+
+  return n_flagged;
+}
+
+/**
+ * median 50% point over the good pixels
+ * @param sc_summary_packet result of ScurveAnalysis::Analyse()
+ */
+float ScurveAnalysis::MedianHalfPoint(SC_SUMMARY_PACKET * sc_summary_packet) {
+
+  std::vector<float> half_points;
+  for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    if (sc_summary_packet->flags[p] == SC_PIXEL_OK) {
+      half_points.push_back(sc_summary_packet->half_point[p]);
+    }
+  }
+
+  return Median(half_points);
+}
+
+/**
+ * median of a set of values, 0 if empty
+ */
+float ScurveAnalysis::Median(std::vector<float> values) {
+
+  if (values.empty()) {
+    return 0;
+  }
+
+  std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+
+  return values[values.size() / 2];
+}
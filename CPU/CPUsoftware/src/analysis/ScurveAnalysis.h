@@ -0,0 +1,43 @@
+#ifndef _SCURVE_ANALYSIS_H
+#define _SCURVE_ANALYSIS_H
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+#include "log.h"
+#include "CpuTools.h"
+#include "minieuso_data_format.h"
+
+/* minimum drop in counts over the scan for a pixel to have a transition */
+#define SC_MIN_TRANSITION 10
+/* a pixel is hot if its plateau is above SC_HOT_FACTOR x the PDM median */
+#define SC_HOT_FACTOR 10
+/* plus SC_HOT_MIN_COUNTS, to cope with a plateau at zero */
+#define SC_HOT_MIN_COUNTS 10
+
+/**
+ * analysis of the S-curves of all pixels on board
+ * the S-curve of each pixel is treated as an error function: the moments of
+ * its derivative give the 50% point and width, and the steepest drop gives the pedestal.
+ * the thresholds need not be evenly spaced, as for the adaptive scan.
+ * the inner loops run over the pixels, which are contiguous in the SC_PACKET,
+ * so that they can be vectorised by the compiler
+ */
+class ScurveAnalysis {
+public:
+  ScurveAnalysis();
+  static SC_SUMMARY_PACKET * Analyse(SC_PACKET * sc_packet);
+  static int CountFlagged(SC_SUMMARY_PACKET * sc_summary_packet, uint8_t flag);
+  static float MedianHalfPoint(SC_SUMMARY_PACKET * sc_summary_packet);
+  static std::vector<std::pair<int, int>> TransitionWindows(SC_SUMMARY_PACKET * sc_summary_packet,
+							    float n_sigma, int min_gap);
+  static float Threshold(SC_PACKET * sc_packet, uint32_t i);
+
+private:
+  static float Median(std::vector<float> values);
+};
+
+#endif
+/* _SCURVE_ANALYSIS_H */
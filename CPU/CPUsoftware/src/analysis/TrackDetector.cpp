@@ -0,0 +1,358 @@
+#include "TrackDetector.h"
+
+/**
+ * constructor
+ */
+TrackDetector::TrackDetector() {
+
+  this->_running = false;
+  this->_n_sigma = 0;
+  this->_min_frames = 0;
+  this->_n_frames = 0;
+  this->_last_unix_time = 0;
+  this->_n_tracks = 0;
+}
+
+/**
+ * destructor
+ */
+TrackDetector::~TrackDetector() {
+
+  Stop();
+}
+
+/**
+ * start the worker thread
+ * @param n_sigma a pixel is part of a spot above the background by n_sigma times its fluctuation
+ * @param min_frames minimum number of frames of a track, 0 to disable the detector
+ */
+void TrackDetector::Start(float n_sigma, int min_frames) {
+
+  if (this->_running || min_frames <= 0) {
+    return;
+  }
+
+  this->_n_sigma = n_sigma;
+  this->_min_frames = min_frames;
+  this->_n_frames = 0;
+  this->_last_unix_time = 0;
+  this->_n_tracks = 0;
+  this->_open.clear();
+
+  {
+    std::unique_lock<std::mutex> lock(this->_m_jobs);
+    this->_running = true;
+  }
+  this->_worker = std::thread(&TrackDetector::Run, this);
+
+  clog << "info: " << logstream::info << "started the track detector" << std::endl;
+}
+
+/**
+ * process the remaining packets, write the open tracks and stop the worker thread
+ */
+void TrackDetector::Stop() {
+
+  {
+    std::unique_lock<std::mutex> lock(this->_m_jobs);
+    this->_running = false;
+  }
+  this->_cv_jobs.notify_all();
+
+  if (this->_worker.joinable()) {
+    this->_worker.join();
+    clog << "info: " << logstream::info << "stopped the track detector" << std::endl;
+  }
+}
+
+/**
+ * queue the D3 data of a packet for the worker thread
+ * @param zynq_packet the packet read out from the Zynq (not modified, can be deleted on return)
+ * @param catalogue_name the catalogue of the current CPU run
+ * @param pkt_num of the CPU_PACKET
+ * returns 1 if the packet is dropped
+ */
+int TrackDetector::Push(ZYNQ_PACKET * zynq_packet, std::string catalogue_name, uint32_t pkt_num) {
+
+  if (!this->_running) {
+    return 1;
+  }
+
+  Job * job = new Job();
+  const uint32_t * d3 = &zynq_packet->level3_data.payload.int32_data[0][0];
+  job->d3.assign(d3, d3 + N_OF_FRAMES_L3_V0 * N_OF_PIXEL_PER_PDM);
+  job->ts = zynq_packet->level3_data.payload.ts;
+  job->catalogue_name = catalogue_name;
+  job->pkt_num = pkt_num;
+
+  {
+    std::unique_lock<std::mutex> lock(this->_m_jobs);
+    if (this->_jobs.size() >= TRACK_MAX_QUEUE) {
+      clog << "error: " << logstream::error << "track detector is behind, packet " << pkt_num << " dropped" << std::endl;
+      delete job;
+      return 1;
+    }
+    this->_jobs.push_back(job);
+  }
+  this->_cv_jobs.notify_one();
+
+  return 0;
+}
+
+/**
+ * worker thread, runs until Stop() and the queue is empty
+ */
+void TrackDetector::Run() {
+
+  while (true) {
+
+    Job * job = NULL;
+    {
+      std::unique_lock<std::mutex> lock(this->_m_jobs);
+      this->_cv_jobs.wait(lock, [this] { return !this->_jobs.empty() || !this->_running; });
+      if (this->_jobs.empty()) {
+	break;
+      }
+      job = this->_jobs.front();
+      this->_jobs.pop_front();
+    }
+
+    Process(job);
+    delete job;
+  }
+
+  /* the night is over for the open tracks */
+  CloseTracks(this->_n_frames + TRACK_MAX_GAP + 1);
+}
+
+/**
+ * find the spots in each frame of a packet and link them
+ * @param job the D3 data of the packet
+ */
+void TrackDetector::Process(Job * job) {
+
+  int p = 0;
+
+  /* no tracks across missing packets */
+  long dt = (long)job->ts.unix_time - (long)this->_last_unix_time;
+  if (this->_last_unix_time != 0 && std::abs(dt) > TRACK_MAX_PKT_GAP) {
+    CloseTracks(this->_n_frames + TRACK_MAX_GAP + 1);
+  }
+
+  /* background of each pixel over the packet, frames outside and pixels inside */
+  std::vector<float> mean(N_OF_PIXEL_PER_PDM);
+  std::vector<float> m2(N_OF_PIXEL_PER_PDM);
+  PixelMonitor::FrameStats(job->d3.data(), mean.data(), m2.data());
+
+  /* NB: at least Poisson fluctuations, as a spot in a few frames is part of the variance */
+  std::vector<float> limit(N_OF_PIXEL_PER_PDM);
+  for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    float var = m2[p] / (N_OF_FRAMES_L3_V0 - 1);
+    limit[p] = mean[p] + this->_n_sigma * std::sqrt(std::max(std::max(var, mean[p]), 1.0f));
+  }
+
+  std::vector<float> excess(N_OF_PIXEL_PER_PDM);
+  std::vector<uint8_t> hit(N_OF_PIXEL_PER_PDM);
+  std::vector<float> excess_grid(MASK_SIZE * MASK_SIZE);
+  std::vector<uint8_t> hit_grid(MASK_SIZE * MASK_SIZE);
+  for (int f = 0; f < N_OF_FRAMES_L3_V0; f++) {
+
+    const uint32_t * frame = job->d3.data() + f * N_OF_PIXEL_PER_PDM;
+    const long g = this->_n_frames + f;
+    int n_hits = 0;
+    for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+      float x = (float)(int32_t)frame[p];
+      excess[p] = x - mean[p];
+      hit[p] = (x > limit[p]);
+      n_hits += hit[p];
+    }
+
+    /* most frames have nothing, and flashes fill the PDM */
+    if (n_hits > 0 && n_hits <= TRACK_MAX_HIT_PIXELS) {
+
+      PixelTransform::ToFocal(hit.data(), hit_grid.data());
+      PixelTransform::ToFocal(excess.data(), excess_grid.data());
+
+      std::vector<Spot> spots = FindSpots(hit_grid, excess_grid, g);
+      Link(spots, job, f);
+    }
+
+    CloseTracks(g - TRACK_MAX_GAP);
+  }
+
+  this->_n_frames += N_OF_FRAMES_L3_V0;
+  this->_last_unix_time = job->ts.unix_time;
+}
+
+/**
+ * group the pixels above threshold of a frame into spots, with 8-connectivity
+ * @param hits pixels above threshold in the focal plane
+ * @param excess counts above the background in the focal plane
+ * @param frame since Start()
+ */
+std::vector<TrackDetector::Spot> TrackDetector::FindSpots(const std::vector<uint8_t> & hits,
+							   const std::vector<float> & excess, long frame) {
+
+  std::vector<Spot> spots;
+  std::vector<uint8_t> visited(MASK_SIZE * MASK_SIZE, 0);
+  std::vector<int> stack;
+
+  for (int start = 0; start < MASK_SIZE * MASK_SIZE; start++) {
+
+    if (!hits[start] || visited[start]) {
+      continue;
+    }
+
+    Spot spot = {frame, 0, 0, 0, 0, 0};
+    float row_sum = 0, col_sum = 0;
+    stack.push_back(start);
+    visited[start] = 1;
+    while (!stack.empty()) {
+
+      int i = stack.back();
+      stack.pop_back();
+      int row = i / MASK_SIZE;
+      int col = i % MASK_SIZE;
+      float w = std::max(excess[i], 0.0f);
+      spot.n_pixels++;
+      spot.sum += w;
+      spot.peak = std::max(spot.peak, w);
+      row_sum += w * row;
+      col_sum += w * col;
+
+      for (int dr = -1; dr <= 1; dr++) {
+	for (int dc = -1; dc <= 1; dc++) {
+	  int r = row + dr;
+	  int c = col + dc;
+	  if (r < 0 || r >= MASK_SIZE || c < 0 || c >= MASK_SIZE) {
+	    continue;
+	  }
+	  int j = r * MASK_SIZE + c;
+	  if (hits[j] && !visited[j]) {
+	    visited[j] = 1;
+	    stack.push_back(j);
+	  }
+	}
+      }
+    }
+
+    if (spot.sum > 0) {
+      spot.row = row_sum / spot.sum;
+      spot.col = col_sum / spot.sum;
+      spots.push_back(spot);
+    }
+  }
+
+  return spots;
+}
+
+/**
+ * add each spot to the nearest open track, or start a new one
+ * @param spots of frame f
+ * @param job the packet of the spots
+ * @param f the frame in the packet
+ */
+void TrackDetector::Link(std::vector<Spot> & spots, Job * job, int f) {
+
+  /* brightest spots first */
+  std::sort(spots.begin(), spots.end(), [](const Spot & a, const Spot & b) { return a.sum > b.sum; });
+
+  for (auto & spot : spots) {
+
+    Track * best = NULL;
+    float best_dist = TRACK_MAX_STEP;
+    for (auto & track : this->_open) {
+      const Spot & last = track.spots.back();
+      if (last.frame >= spot.frame || last.frame < spot.frame - 1 - TRACK_MAX_GAP) {
+	continue;
+      }
+      float dist = std::hypot(spot.row - last.row, spot.col - last.col);
+      if (dist <= best_dist) {
+	best = &track;
+	best_dist = dist;
+      }
+    }
+
+    if (best != NULL) {
+      best->spots.push_back(spot);
+    }
+    else {
+      Track track;
+      track.catalogue_name = job->catalogue_name;
+      track.pkt_num = job->pkt_num;
+      track.first_frame = f;
+      track.time = job->ts.unix_time + f * D3_FRAME_SEC;
+      track.spots.push_back(spot);
+      this->_open.push_back(track);
+    }
+  }
+}
+
+/**
+ * write and forget the tracks without a spot since before_frame
+ */
+void TrackDetector::CloseTracks(long before_frame) {
+
+  auto it = this->_open.begin();
+  while (it != this->_open.end()) {
+    if (it->spots.back().frame < before_frame) {
+      WriteTrack(*it);
+      it = this->_open.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+/**
+ * append a track to its catalogue, if it is long enough and moves
+ * one line per track: id in the night, pkt_num, frame, unix time, number of frames,
+ * number of pixels, peak and sum of the counts above background, then the
+ * path as frame:row:col of each spot, with the frame relative to the first
+ */
+int TrackDetector::WriteTrack(Track & track) {
+
+  const Spot & first = track.spots.front();
+  const Spot & last = track.spots.back();
+  float displacement = std::hypot(last.row - first.row, last.col - first.col);
+  if ((int)track.spots.size() < this->_min_frames || displacement < TRACK_MIN_DISPLACEMENT) {
+    return 1;
+  }
+
+  /* NB: a track is written to the catalogue of the run in which it started */
+  bool new_catalogue = !std::ifstream(track.catalogue_name).good();
+  std::ofstream catalogue(track.catalogue_name, std::ios::app);
+  if (!catalogue.is_open()) {
+    clog << "error: " << logstream::error << "cannot open " << track.catalogue_name << std::endl;
+    return 1;
+  }
+  if (new_catalogue) {
+    catalogue << "# tracks found on board in the D3 data, rows and columns in the DeadPixelMask.txt focal plane" << std::endl;
+    catalogue << "# id pkt_num frame time n_frames n_pixels peak sum path" << std::endl;
+  }
+
+  uint32_t n_pixels = 0;
+  float peak = 0, sum = 0;
+  for (auto & spot : track.spots) {
+    n_pixels += spot.n_pixels;
+    peak = std::max(peak, spot.peak);
+    sum += spot.sum;
+  }
+
+  catalogue << this->_n_tracks << " " << track.pkt_num << " " << track.first_frame << " "
+	    << std::fixed << std::setprecision(2) << track.time << " "
+	    << track.spots.size() << " " << n_pixels << " "
+	    << std::setprecision(0) << peak << " " << sum << " " << std::setprecision(1);
+  for (auto & spot : track.spots) {
+    catalogue << (spot.frame - first.frame) << ":" << spot.row << ":" << spot.col
+	      << ((&spot == &last) ? "" : ";");
+  }
+  catalogue << std::endl;
+
+  clog << "info: " << logstream::info << "track " << this->_n_tracks << " of " << track.spots.size()
+       << " frames added to " << track.catalogue_name << std::endl;
+  this->_n_tracks++;
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+#ifndef _TRACK_DETECTOR_H
+#define _TRACK_DETECTOR_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "log.h"
+#include "PixelMonitor.h"
+#include "PixelTransform.h"
+#include "minieuso_data_format.h"
+
+/* duration of one D3 frame in seconds */
+#define D3_FRAME_SEC 0.04096
+/* maximum number of D3 packets waiting for the worker thread, others are dropped */
+#define TRACK_MAX_QUEUE 2
+/* maximum number of frames without a spot inside a track */
+#define TRACK_MAX_GAP 2
+/* maximum distance in pixels between the spots of a track in successive frames */
+#define TRACK_MAX_STEP 3.0f
+/* minimum distance in pixels between the first and last spot of a track */
+#define TRACK_MIN_DISPLACEMENT 1.0f
+/* frames with more pixels above threshold are flashes, not tracks */
+#define TRACK_MAX_HIT_PIXELS (N_OF_PIXEL_PER_PDM / 10)
+/* packets further apart in unix time are not linked */
+#define TRACK_MAX_PKT_GAP 6
+
+/**
+ * streaming detector of slow moving spots, such as meteors, in the D3 data.
+ * in each D3 frame, the pixels above the background of the packet are
+ * grouped into spots, and spots close in successive frames are linked into
+ * tracks, also across packets. the tracks which move are appended to a text
+ * catalogue for each CPU run. the detection runs in a worker thread, on a
+ * copy of the D3 data, so that it does not delay the ingest of the packets
+ */
+class TrackDetector {
+public:
+  TrackDetector();
+  ~TrackDetector();
+  void Start(float n_sigma, int min_frames);
+  void Stop();
+  int Push(ZYNQ_PACKET * zynq_packet, std::string catalogue_name, uint32_t pkt_num);
+
+private:
+  /**
+   * a connected group of pixels above threshold in one frame
+   */
+  struct Spot {
+    long frame; /* since Start() */
+    float row; /* centroid in the focal plane */
+    float col;
+    uint32_t n_pixels;
+    float sum; /* counts above the background */
+    float peak;
+  };
+  /**
+   * a set of linked spots
+   */
+  struct Track {
+    std::string catalogue_name;
+    uint32_t pkt_num; /* of the first spot */
+    int first_frame; /* in the packet of the first spot */
+    double time; /* unix time of the first spot */
+    std::vector<Spot> spots;
+  };
+  /**
+   * a D3 packet waiting for the worker thread
+   */
+  struct Job {
+    std::vector<uint32_t> d3;
+    TimeStamp_dual ts;
+    std::string catalogue_name;
+    uint32_t pkt_num;
+  };
+
+  std::thread _worker;
+  std::mutex _m_jobs;
+  std::condition_variable _cv_jobs;
+  std::deque<Job *> _jobs;
+  bool _running;
+
+  /* only used by the worker thread */
+  float _n_sigma;
+  int _min_frames;
+  long _n_frames;
+  uint32_t _last_unix_time;
+  uint32_t _n_tracks;
+  std::vector<Track> _open;
+
+  void Run();
+  void Process(Job * job);
+  std::vector<Spot> FindSpots(const std::vector<uint8_t> & hits, const std::vector<float> & excess, long frame);
+  void Link(std::vector<Spot> & spots, Job * job, int f);
+  void CloseTracks(long before_frame);
+  int WriteTrack(Track & track);
+};
+
+#endif
+/* _TRACK_DETECTOR_H */
@@ -0,0 +1,139 @@
+#include "TransientClassifier.h"
+
+/**
+ * constructor
+ */
+TransientClassifier::TransientClassifier() {
+
+}
+
+/**
+ * classify the D1 and D2 blocks of a ZYNQ_PACKET
+ * @param zynq_packet the packet read out from the Zynq (not modified)
+ * returns a new FLAGS_PACKET
+ */
+FLAGS_PACKET * TransientClassifier::Classify(ZYNQ_PACKET * zynq_packet) {
+
+  FLAGS_PACKET * flags_packet = new FLAGS_PACKET();
+  flags_packet->flags_packet_header.header = CpuTools::BuildCpuHeader(FLAGS_PACKET_TYPE, FLAGS_PACKET_VER);
+  flags_packet->flags_packet_header.pkt_size = sizeof(FLAGS_PACKET);
+  flags_packet->flags_time.cpu_time_stamp = CpuTools::BuildCpuTimeStamp();
+  flags_packet->N1 = zynq_packet->level1_data.size();
+  flags_packet->N2 = zynq_packet->level2_data.size();
+
+  for (int i = 0; i < MAX_PACKETS_L1; i++) {
+    if (i < (int)zynq_packet->level1_data.size()) {
+      DATA_TYPE_SCI_L1_V2 & l1 = zynq_packet->level1_data[i].payload;
+      flags_packet->l1_flags[i] = ScoreBlock<uint8_t>(l1.raw_data, N_OF_FRAMES_L1_V0, l1.trig_type, D1_SATURATION);
+    }
+    else {
+      flags_packet->l1_flags[i].flags = TRANSIENT_EMPTY;
+    }
+  }
+
+  /* NB: no saturation in the D2 data */
+  for (int i = 0; i < MAX_PACKETS_L2; i++) {
+    if (i < (int)zynq_packet->level2_data.size()) {
+      DATA_TYPE_SCI_L2_V2 & l2 = zynq_packet->level2_data[i].payload;
+      flags_packet->l2_flags[i] = ScoreBlock<uint16_t>(l2.int16_data, N_OF_FRAMES_L2_V0, l2.trig_type, 0);
+    }
+    else {
+      flags_packet->l2_flags[i].flags = TRANSIENT_EMPTY;
+    }
+  }
+
+  return flags_packet;
+}
+
+/**
+ * score a D1 or D2 block
+ * @param frames the pixel data of the block
+ * @param n_frames number of frames in the block
+ * @param trig_type copied to the result
+ * @param saturation value of a saturated pixel, 0 if the data do not saturate
+ */
+template <typename T>
+TransientFlags TransientClassifier::ScoreBlock(const T frames[][N_OF_PIXEL_PER_PDM], int n_frames, uint32_t trig_type,
+					       T saturation) {
+
+  TransientFlags result = TransientFlags();
+  result.trig_type = trig_type;
+  int p = 0;
+
+  /* background and fluctuation of each pixel before the trigger, at least Poisson */
+  std::vector<float> mean(N_OF_PIXEL_PER_PDM, 0);
+  std::vector<float> m2(N_OF_PIXEL_PER_PDM, 0);
+  for (int f = 0; f < TRANSIENT_BG_FRAMES; f++) {
+    const T * frame = frames[f];
+    const float inv_n = 1.0f / (f + 1);
+    for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+      float x = frame[p];
+      float delta = x - mean[p];
+      mean[p] += delta * inv_n;
+      m2[p] += delta * (x - mean[p]);
+    }
+  }
+  std::vector<float> limit(N_OF_PIXEL_PER_PDM);
+  std::vector<float> inv_sigma(N_OF_PIXEL_PER_PDM);
+  for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+    float var = m2[p] / (TRANSIENT_BG_FRAMES - 1);
+    float sigma = std::sqrt(std::max(std::max(var, mean[p]), 1.0f));
+    inv_sigma[p] = 1.0f / sigma;
+    limit[p] = mean[p] + TRANSIENT_N_SIGMA * sigma;
+  }
+
+  /* lit pixels and frame differences, frames outside and pixels inside */
+  std::vector<float> radius(n_frames, 0);
+  int n_saturated = 0;
+  for (int f = 0; f < n_frames; f++) {
+
+    const T * frame = frames[f];
+    const T * prev = frames[(f > 0) ? f - 1 : 0];
+    int n_lit = 0;
+    float max_diff = 0;
+    for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+      float x = frame[p];
+      float diff = (x - (float)prev[p]) * inv_sigma[p];
+      n_lit += (x > limit[p]);
+      max_diff = (diff > max_diff) ? diff : max_diff;
+    }
+    if (saturation > 0) {
+      for (p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+	n_saturated += (frame[p] >= saturation);
+      }
+    }
+
+    radius[f] = std::sqrt(n_lit / M_PI);
+    result.extent = std::max(result.extent, (uint16_t)n_lit);
+    if (max_diff > result.peak) {
+      result.peak = max_diff;
+      result.peak_frame = f;
+    }
+  }
+
+  /* growth of the lit area */
+  for (int f = TRANSIENT_SPEED_FRAMES; f < n_frames; f++) {
+    float speed = (radius[f] - radius[f - TRANSIENT_SPEED_FRAMES]) / TRANSIENT_SPEED_FRAMES;
+    result.expansion = std::max(result.expansion, speed);
+  }
+
+  if (result.extent >= TRANSIENT_EXTENT_MIN) {
+    result.flags |= TRANSIENT_EXTENDED;
+  }
+  if (result.expansion >= TRANSIENT_SPEED_MIN) {
+    result.flags |= TRANSIENT_EXPANDING;
+  }
+  if ((result.flags & TRANSIENT_EXTENDED) && (result.flags & TRANSIENT_EXPANDING)) {
+    result.flags |= TRANSIENT_ELVE_CANDIDATE;
+  }
+  if (n_saturated > 0) {
+    result.flags |= TRANSIENT_SATURATED;
+  }
+
+  /* each term is between 0 and 1 */
+  result.score = (std::min(result.extent / (float)TRANSIENT_EXTENT_SCALE, 1.0f)
+		  + std::min(result.expansion / TRANSIENT_SPEED_SCALE, 1.0f)
+		  + std::min(result.peak / TRANSIENT_PEAK_SCALE, 1.0f)) / 3.0f;
+
+  return result;
+}
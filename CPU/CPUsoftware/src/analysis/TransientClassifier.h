@@ -0,0 +1,46 @@
+#ifndef _TRANSIENT_CLASSIFIER_H
+#define _TRANSIENT_CLASSIFIER_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "log.h"
+#include "CpuTools.h"
+#include "minieuso_data_format.h"
+
+/* number of frames at the start of a block used as background, before the trigger */
+#define TRANSIENT_BG_FRAMES 32
+/* a pixel is lit above its background by this many times its fluctuation */
+#define TRANSIENT_N_SIGMA 5.0f
+/* number of frames over which the growth of the lit area is measured */
+#define TRANSIENT_SPEED_FRAMES 4
+/* an extended transient lights at least a PMT */
+#define TRANSIENT_EXTENT_MIN N_OF_PIXELS_PER_PMT
+/* an expanding transient grows by at least this many pixels in radius per frame */
+#define TRANSIENT_SPEED_MIN 0.5f
+/* values of the extent, expansion and peak for which each counts fully in the score */
+#define TRANSIENT_EXTENT_SCALE (4 * N_OF_PIXELS_PER_PMT)
+#define TRANSIENT_SPEED_SCALE 1.0f
+#define TRANSIENT_PEAK_SCALE 50.0f
+
+/**
+ * classification of the D1 and D2 blocks of a packet by their fast transients,
+ * such as ELVEs, which are bright, extended and expand quickly.
+ * each block is scored from its spatial extent, the expansion speed of the
+ * lit area and the peak amplitude, from the differences of successive frames
+ * and the background of the frames before the trigger
+ */
+class TransientClassifier {
+public:
+  TransientClassifier();
+  static FLAGS_PACKET * Classify(ZYNQ_PACKET * zynq_packet);
+
+private:
+  template <typename T>
+  static TransientFlags ScoreBlock(const T frames[][N_OF_PIXEL_PER_PDM], int n_frames, uint32_t trig_type,
+				   T saturation);
+};
+
+#endif
+/* _TRANSIENT_CLASSIFIER_H */
@@ -92,23 +92,20 @@ int RunInstrument::HvpsSwitch() {
   switch (this->CmdLine->hvps_status) {
   case ZynqManager::ON:
     std::cout << "Switching ON the HVPS" << std::endl;
-    {
-      std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-      this->Zynq.HvpsTurnOn(this->ConfigOut->cathode_voltage,
-			    this->ConfigOut->dynode_voltage_string,
-			    this->CmdLine->hvps_ec_string);
-    }
+    this->Zynq.HvpsTurnOn(this->ConfigOut->cathode_voltage,
+			  this->ConfigOut->dynode_voltage_string,
+			  this->CmdLine->hvps_ec_string);
     break;
   case ZynqManager::OFF:
     std::cout << "Switching OFF the HVPS" << std::endl;
-    {
-      std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-      this->Zynq.HvpsTurnOff();
-      if (this->ConfigOut->dac_level != NO_DAC_SET) {
-	this->Zynq.SetDac(0);
-      }
-      break;
-    }
+    /* ahead of the other commands, and of the rest of an HV ramp */
+    this->Zynq.Run<int>([this]() {
+	this->Zynq.HvpsTurnOff();
+	if (this->ConfigOut->dac_level != NO_DAC_SET) {
+	  this->Zynq.SetDac(0);
+	}
+	return 0; }, ZynqManager::LANE_URGENT, ZYNQ_HV_OFF_KEY);
+    break;
   case ZynqManager::UNDEF:
     std::cout << "Error: Cannot switch subsystem, on/off undefined" << std::endl;
     break;
@@ -123,21 +120,11 @@ return 0;
  */
 int RunInstrument::CheckStatus() {
 
-  /* test the connection to the zynq board */
-  {
-    std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-    this->Zynq.CheckConnect();
-
-    if (this->Zynq.telnet_connected) {
-      /* check the instrument and HV status */
-      this->Zynq.GetInstStatus();
-      this->Zynq.GetHvpsStatus();
-    }
-
-    else {
-      std::cout << "ERROR: Zynq cannot reach Mini-EUSO over telnet" << std::endl;
-      std::cout << "first try to ping 192.168.7.10 then try again" << std::endl;
-    }
+  /* test the connection to the zynq board, and check the instrument and HV status */
+  this->Zynq.UpdateStatus();
+  if (!this->Zynq.telnet_connected) {
+    std::cout << "ERROR: Zynq cannot reach Mini-EUSO over telnet" << std::endl;
+    std::cout << "first try to ping " << this->Zynq.GetIp() << " then try again" << std::endl;
   }
 
   return 0;
@@ -210,17 +197,10 @@ int RunInstrument::DebugMode() {
   this->Lvps.SwitchOff(LvpsManager::CAMERAS);
 
   std::cout << "ZYNQ" << std::endl;
-  {
-    std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-    this->Zynq.CheckConnect();
-    if (this->Zynq.telnet_connected) {
-      this->Zynq.GetInstStatus();
-      this->Zynq.GetHvpsStatus();
-    }
-    else {
-      std::cout << "ERROR: Zynq cannot reach Mini-EUSO over telnet" << std::endl;
-      std::cout << "first try to ping 192.168.7.10 then try again" << std::endl;
-    }
+  this->Zynq.UpdateStatus();
+  if (!this->Zynq.telnet_connected) {
+    std::cout << "ERROR: Zynq cannot reach Mini-EUSO over telnet" << std::endl;
+    std::cout << "first try to ping " << this->Zynq.GetIp() << " then try again" << std::endl;
   }
   std::cout << std::endl;
 
@@ -257,7 +237,7 @@ int RunInstrument::DebugMode() {
   */
   
   /* test new DAC10 commands */
-  std::string path(USB_MOUNTPOINT_0);
+  std::string path(this->ConfigOut->usb_mountpoint_0);
   this->Zynq.SetMatrixDac10(path, false);
   
   return 0;
@@ -317,7 +297,7 @@ int RunInstrument::InitInstMode() {
 
     /* set to day mode */
     /* To notify isDay to an external program for zip purpose */
-    this->isDay.open("/media/usb0/is_day.txt");
+    this->isDay.open(this->ConfigOut->usb_mountpoint_0 + "/" + IS_DAY_FILE_NAME);
     this->isDay <<  "1";
     this->isDay.close();
 
@@ -328,7 +308,7 @@ int RunInstrument::InitInstMode() {
 
     /* set to night mode */
     /* To notify isDay to an external program for zip purpose */
-    this->isDay.open ("/media/usb0/is_day.txt");
+    this->isDay.open(this->ConfigOut->usb_mountpoint_0 + "/" + IS_DAY_FILE_NAME);
     this->isDay <<  "2";
     this->isDay.close();
 
@@ -340,7 +320,7 @@ int RunInstrument::InitInstMode() {
     if (GetInstMode() == INST_UNDEF){
       /* set to day mode to be safe */
       /* To notify isDay to an external program for zip purpose */
-      this->isDay.open ("/media/usb0/is_day.txt");
+      this->isDay.open(this->ConfigOut->usb_mountpoint_0 + "/" + IS_DAY_FILE_NAME);
       this->isDay <<  "3";
       this->isDay.close();
       
@@ -382,11 +362,13 @@ int RunInstrument::StartUp() {
   clog << "info: " << logstream::info << "Mini-EUSO CPU SOFTWARE Version: " << VERSION << " Date: " << VERSION_DATE_STRING << std::endl;
   
   /* reload and parse the configuration file */
+  /* the USB files are on the mountpoints of the local configuration */
   std::string config_dir(CONFIG_DIR);
-  std::string conf_file_usb0 = "/media/usb0/dummy_usb.conf";
-  std::string conf_file_usb1 = "/media/usb1/dummy_usb.conf";
   std::string conf_file_local = config_dir + "/dummy_local.conf";
-  ConfigManager CfManager(conf_file_local, conf_file_usb0, conf_file_usb1);
+  if (!this->CmdLine->config_file.empty()) {
+    conf_file_local = this->CmdLine->config_file;
+  }
+  ConfigManager CfManager(conf_file_local, "", "");
   CfManager.Configure();
 
   /* check the configuration file has been parsed */
@@ -418,6 +400,24 @@ int RunInstrument::StartUp() {
     this->ConfigOut->scurve_acc = this->CmdLine->sc_acc;
   }
 
+  /* the Zynq and the directories of this instance */
+  this->Zynq.SetEndpoint(this->ConfigOut->zynq_ip, this->ConfigOut->telnet_port);
+  this->Daq.data_dir = this->ConfigOut->data_dir;
+  this->Daq.usb_dir = this->ConfigOut->usb_mountpoint_0;
+  this->Daq.done_dir = this->ConfigOut->done_dir;
+  this->Daq.zynq_ip = this->ConfigOut->zynq_ip;
+  this->Usb.mountpoint_0 = this->ConfigOut->usb_mountpoint_0;
+  this->Usb.mountpoint_1 = this->ConfigOut->usb_mountpoint_1;
+  if (this->CmdLine->log_on) {
+    MoveLog(this->ConfigOut->log_dir);
+  }
+
+  /* the files kept between runs by this instance */
+  this->Daq.PixelMon.mask_file_name = this->ConfigOut->state_dir + "/" + AUTO_MASK_FILE_NAME;
+  this->Zynq.auto_mask_file = this->Daq.PixelMon.mask_file_name;
+  this->Daq.Calib.cache_file_name = this->ConfigOut->state_dir + "/" + CALIB_CACHE_FILE_NAME;
+  this->Daq.Calib.Load();
+
   //By Giammanco to switchoff the broken pixels
   if (this->CmdLine->hide_pixel == true) {
     this->Zynq.HidePixels();
@@ -432,6 +432,7 @@ int RunInstrument::StartUp() {
   printf("SCURVE_STEP is %d\n", this->ConfigOut->scurve_step);
   printf("SCURVE_STOP is %d\n", this->ConfigOut->scurve_stop);
   printf("SCURVE_ACC is %d\n", this->ConfigOut->scurve_acc);
+  printf("SCURVE_COARSE_STEP is %d\n", this->ConfigOut->scurve_coarse_step);
   if (this->ConfigOut->dac_level == NO_DAC_SET) {
    printf("DAC_LEVEL will not be set by the software");
   }
@@ -452,6 +453,24 @@ int RunInstrument::StartUp() {
   printf("STATUS_PERIOD is %d\n", this->ConfigOut->status_period);
   printf("POWER_ON_DELAY is %d\n", this->ConfigOut->pwr_on_delay);
   printf("CAMERA_ON is %d\n", this->ConfigOut->camera_on);
+  printf("DAC_TUNE_RATE is %d\n", this->ConfigOut->dac_tune_rate);
+  printf("DAC_TUNE_ACC is %d\n", this->ConfigOut->dac_tune_acc);
+  printf("PIXEL_MASK_N_SIGMA is %.1f\n", this->ConfigOut->pixel_mask_n_sigma);
+  printf("PIXEL_MASK_PERSIST is %d\n", this->ConfigOut->pixel_mask_persist);
+  printf("TRACK_N_SIGMA is %.1f\n", this->ConfigOut->track_n_sigma);
+  printf("TRACK_MIN_FRAMES is %d\n", this->ConfigOut->track_min_frames);
+  printf("DOWNLINK_BUDGET is %ld\n", this->ConfigOut->downlink_budget);
+  printf("DOWNLINK_TOP_K is %d\n", this->ConfigOut->downlink_top_k);
+  printf("RATE_STEP_FACTOR is %.1f\n", this->ConfigOut->rate_step_factor);
+  printf("RATE_ACTION is %d\n", this->ConfigOut->rate_action);
+  printf("ZYNQ_IP is %s\n", this->ConfigOut->zynq_ip.c_str());
+  printf("TELNET_PORT is %d\n", this->ConfigOut->telnet_port);
+  printf("DATA_DIR is %s\n", this->ConfigOut->data_dir.c_str());
+  printf("DONE_DIR is %s\n", this->ConfigOut->done_dir.c_str());
+  printf("USB_MOUNTPOINT_0 is %s\n", this->ConfigOut->usb_mountpoint_0.c_str());
+  printf("USB_MOUNTPOINT_1 is %s\n", this->ConfigOut->usb_mountpoint_1.c_str());
+  printf("LOG_DIR is %s\n", this->ConfigOut->log_dir.c_str());
+  printf("STATE_DIR is %s\n", this->ConfigOut->state_dir.c_str());
 
   std::cout << std::endl;
   
@@ -539,11 +558,10 @@ int RunInstrument::SelectAcqOption() {
   }
 
   /* select Zynq acquisition mode */
-  {
-    std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-    this->Zynq.zynq_mode = this->CmdLine->zynq_mode;
-    this->Zynq.test_mode = this->CmdLine->zynq_test_mode;
-  }
+  this->Zynq.Run<int>([this]() {
+      this->Zynq.zynq_mode = this->CmdLine->zynq_mode;
+      this->Zynq.test_mode = this->CmdLine->zynq_test_mode;
+      return 0; });
 
   return 0;
 }
@@ -686,7 +704,7 @@ int RunInstrument::PollInstrument() {
 	clog << "info: " << logstream::info << "PollInstrument: from night to day" << std::endl;
  
 	/* To notify isDay to an external program for zip purpose */
-	this->isDay.open ("/media/usb0/is_day.txt");
+	this->isDay.open(this->ConfigOut->usb_mountpoint_0 + "/" + IS_DAY_FILE_NAME);
 	this->isDay <<  "1";
 	this->isDay.close();
 
@@ -708,7 +726,7 @@ int RunInstrument::PollInstrument() {
 	clog << "info: " << logstream::info << "PollInstrument: from day to night" << std::endl;
  
 	/* To notify isDay to an external program for zip purpose */
-	this->isDay.open ("/media/usb0/is_day.txt");
+	this->isDay.open(this->ConfigOut->usb_mountpoint_0 + "/" + IS_DAY_FILE_NAME);
 	this->isDay<< "2";
 	this->isDay.close();
 
@@ -722,7 +740,7 @@ int RunInstrument::PollInstrument() {
 
       std::cout << "ERROR: instrument mode is undefined" << std::endl;
       /* To notify isDay to an external program for zip purpose */
-      this->isDay.open ("/media/usb0/is_day.txt");
+      this->isDay.open(this->ConfigOut->usb_mountpoint_0 + "/" + IS_DAY_FILE_NAME);
       this->isDay<< "3";
       this->isDay.close();
 
@@ -831,16 +849,13 @@ int RunInstrument::RunningStatusCheck() {
 
     /* telnet connection and HV */
     {
-      std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-      this->Zynq.CheckConnect();
-
+      /* a status query already in the queue answers this one too */
       std::cout << "Checking telnet connection..." << std::endl;
+      this->Zynq.UpdateStatus();
+
       if (this->Zynq.telnet_connected) {
 	zynq_telnet_status = "CONNECTED";
 	std::cout << "Telnet connection: " << zynq_telnet_status << std::endl;
-	/* check the instrument and HV status */
-	this->Zynq.GetInstStatus();
-	this->Zynq.GetHvpsStatus();
       }
       else {
 	zynq_telnet_status = "DISCONNECTED";
@@ -884,23 +899,24 @@ int RunInstrument::Acquisition() {
   clog << "info: " << logstream::info << "starting acquisition run" << std::endl;
 
   /* clear the FTP server */
-  CpuTools::ClearFolder(DATA_DIR);
-  {
-    std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-    this->Zynq.InstrumentClean();
-  }
+  CpuTools::ClearFolder(this->ConfigOut->data_dir.c_str());
+  this->Zynq.InstrumentClean();
   
   /* add acquisition with cameras if required */
   this->LaunchCam();
 
 
-  /* set the ASIC DAC */
-  if (this->ConfigOut->dac_level != NO_DAC_SET) {
-    {
-      std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-      this->Zynq.SetDac(this->ConfigOut->dac_level);
+  /* tune the ASIC DAC from an S-curve, or set it */
+  bool dac_tuned = false;
+  if (this->CmdLine->dac_tune && !this->CmdLine->sc_on && this->Zynq.telnet_connected) {
+    dac_tuned = (this->Daq.TuneDac(&this->Zynq, this->ConfigOut, this->CmdLine) == 0);
+    if (!dac_tuned) {
+      clog << "error: " << logstream::error << "DAC tuning failed, using DAC_LEVEL" << std::endl;
     }
   }
+  if (!dac_tuned && this->ConfigOut->dac_level != NO_DAC_SET) {
+    this->Zynq.SetDac(this->ConfigOut->dac_level);
+  }
 
   /* select SCURVE or STANDARD acquisition */
   if (this->Zynq.telnet_connected) {
@@ -909,7 +925,12 @@ int RunInstrument::Acquisition() {
     case SCURVE:
 
       /* take an scurve */
-      Daq.CollectSc(&this->Zynq, this->ConfigOut, this->CmdLine);
+      if (this->CmdLine->sc_adaptive) {
+	Daq.CollectAdaptiveSc(&this->Zynq, this->ConfigOut, this->CmdLine);
+      }
+      else {
+	Daq.CollectSc(&this->Zynq, this->ConfigOut, this->CmdLine);
+      }
 
       break;
     case STANDARD:
@@ -970,34 +991,14 @@ int RunInstrument::NightOperations() {
   /* only reboot & reset the Zynq if not an S-curve acquisition */
   if (!this->CmdLine->sc_on) {
     
-    /* reboot the Zynq */
+    /* reboot the Zynq, and set it up as soon as it is ready */
     clog << "info: " << logstream::info << "rebooting the Zynq system" << std::endl;
     std::cout << "rebooting the Zynq system..." << std::endl;
-    {
-      std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-      this->Zynq.Reboot();
-    }
+    std::string usb_str(this->ConfigOut->usb_mountpoint_0);
+    this->Zynq.Restart(usb_str, this->CmdLine->hide_pixel);
 
-    /* wait for telnet connection */
-    clog << "info: " << logstream::info << "waiting for boot" << std::endl;
-    std::cout << "waiting for boot..." << std::endl;
+    /* check the instrument and HV status */
     this->CheckStatus();
-
-    /* setup the Zynq */
-    clog << "info: " << logstream::info << "setting up Zynq with DAC 10 tables and trigger mask" << std::endl; 
-    std::string usb_str(USB_MOUNTPOINT_0);
-    {
-      std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-      this->Zynq.Setup(usb_str);
-    }
-
-    /* set hidden pixels */
-    if (this->CmdLine->hide_pixel == true) {
-      {
-	std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-	this->Zynq.HidePixels();
-      }
-    }
   }
   
   return 0;
@@ -1017,6 +1018,7 @@ int RunInstrument::DayOperations() {
   this->Data.Reset();
 
   /* data reduction runs until signal to switch mode */
+  this->Data.ConfigOut = this->ConfigOut;
   this->Data.Start();
 
   return 0;
@@ -1083,12 +1085,9 @@ void RunInstrument::Start() {
   /* check systems and operational mode */
   this->CheckSystems();
 
-  {
-    std::unique_lock<std::mutex> lock(this->Zynq.m_zynq);
-    if (!this->Zynq.telnet_connected) {
-      std::cout << "no Zynq connection, exiting the program" << std::endl;
-      return;
-    }
+  if (!this->Zynq.telnet_connected) {
+    std::cout << "no Zynq connection, exiting the program" << std::endl;
+    return;
   }
 
   /* launch data backup in background */
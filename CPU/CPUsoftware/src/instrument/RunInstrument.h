@@ -11,8 +11,9 @@
 
 /* location of data files */
 #define HOME_DIR "/home/software/CPU"
-#define DONE_DIR "/home/minieusouser/DONE"
-#define DATA_DIR "/home/minieusouser/DATA"
+
+/* day or night for an external program, on USB_MOUNTPOINT_0 of the configuration */
+#define IS_DAY_FILE_NAME "is_day.txt"
 
 /* signal to not set the dac_level */
 #define NO_DAC_SET -99
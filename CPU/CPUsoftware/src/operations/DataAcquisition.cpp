@@ -9,10 +9,27 @@ DataAcquisition::DataAcquisition() {
   this->cpu_main_file_name = "";
   this->cpu_sc_file_name = "";    
   this->cpu_hv_file_name = "";
+  this->cpu_ql_file_name = "";
+  this->cpu_lc_file_name = "";
+  this->cpu_l4_file_name = "";
+  this->cpu_tracks_file_name = "";
+  this->QlAccess = NULL;
+  this->_n_cpu_pkts = 0;
+  this->LcAccess = NULL;
+  this->_n_lc_pkts = 0;
+  this->L4Access = NULL;
+  this->_n_l4_pkts = 0;
+  this->_zynq = NULL;
 
   /* usb storage devices */
   this->usb_num_storage_dev = 0;
 
+  /* directories and Zynq address */
+  this->data_dir = DATA_DIR;
+  this->usb_dir = USB_MOUNTPOINT_0;
+  this->done_dir = DONE_DIR;
+  this->zynq_ip = ZYNQ_IP;
+
   /* number of files written */
   {
     std::unique_lock<std::mutex> lock(this->m_nfiles);     
@@ -32,8 +49,8 @@ DataAcquisition::DataAcquisition() {
 std::string DataAcquisition::CreateCpuRunName(RunType run_type, std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine) {
   struct timeval tv;
   char cpu_file_name[MAX_FILENAME_LENGTH];
-  std::string done_str(DONE_DIR);
-  std::string usb_str(USB_MOUNTPOINT_0);
+  std::string done_str(this->done_dir);
+  std::string usb_str(this->usb_dir);
   std::string time_str;
 
   switch (run_type) {
@@ -59,6 +76,18 @@ std::string DataAcquisition::CreateCpuRunName(RunType run_type, std::shared_ptr<
     time_str = "/CPU_RUN_HV__%Y_%m_%d__%H_%M_%S"
       + CmdLine->comment_fn + ".dat";
     break;
+  case QL:
+    time_str = "/CPU_RUN_QL__%Y_%m_%d__%H_%M_%S"
+      + CmdLine->comment_fn + ".dat";
+    break;
+  case LC:
+    time_str = "/CPU_RUN_LC__%Y_%m_%d__%H_%M_%S"
+      + CmdLine->comment_fn + ".dat";
+    break;
+  case L4:
+    time_str = "/CPU_RUN_L4__%Y_%m_%d__%H_%M_%S"
+      + CmdLine->comment_fn + ".dat";
+    break;
   }
   
   std::string cpu_str;
@@ -67,7 +96,7 @@ std::string DataAcquisition::CreateCpuRunName(RunType run_type, std::shared_ptr<
   if (this->usb_num_storage_dev == 1 || usb_num_storage_dev == 2) {
     cpu_str = usb_str + time_str;
   }
-  /* else write in DONE_DIR */
+  /* else write in done_dir */
   else {
     cpu_str = done_str + time_str;
   }
@@ -103,7 +132,8 @@ std::string DataAcquisition::BuildCpuFileInfo(std::shared_ptr<Config> ConfigOut,
   
   strftime(time, sizeof(time), time_fmt, now_tm);
   
-  std::string zynq_ver = ZynqManager::GetZynqVer();
+  /* cached by the ZynqManager, so no round trip to the Zynq */
+  std::string zynq_ver = (this->_zynq != NULL) ? this->_zynq->GetZynqVer() : "";
   
   /* parse the runtime settings into the run_info_string */
   conv << "Experiment: " << INSTRUMENT << std::endl;
@@ -137,6 +167,11 @@ int DataAcquisition::CreateCpuRun(RunType run_type, std::shared_ptr<Config> Conf
     this->cpu_main_file_name = CreateCpuRunName(CPU, ConfigOut, CmdLine);
     clog << "info: " << logstream::info << "Set cpu_main_file_name to: " << cpu_main_file_name << std::endl;
     this->CpuFile = std::make_shared<SynchronisedFile>(this->cpu_main_file_name);
+    /* text catalogue of the tracks, with the same time stamp */
+    this->cpu_tracks_file_name = this->cpu_main_file_name;
+    this->cpu_tracks_file_name.replace(this->cpu_tracks_file_name.rfind("CPU_RUN_MAIN"), 12, "CPU_RUN_TRACKS");
+    this->cpu_tracks_file_name.replace(this->cpu_tracks_file_name.length() - 4, 4, ".txt");
+    this->QlMap.Start(this->cpu_main_file_name);
     cpu_file_header->header = CpuTools::BuildCpuHeader(CPU_FILE_TYPE, CPU_FILE_VER);
     break;
   case SC: 
@@ -151,6 +186,18 @@ int DataAcquisition::CreateCpuRun(RunType run_type, std::shared_ptr<Config> Conf
     this->CpuFile = std::make_shared<SynchronisedFile>(this->cpu_hv_file_name);
     cpu_file_header->header = CpuTools::BuildCpuHeader(HV_FILE_TYPE, HV_FILE_VER);
     break;
+  case QL:
+    clog << "error: " << logstream::error << "QL files are created with CPU runs" << std::endl;
+    delete cpu_file_header;
+    return 1;
+  case LC:
+    clog << "error: " << logstream::error << "LC files are created with the first CPU run of the night" << std::endl;
+    delete cpu_file_header;
+    return 1;
+  case L4:
+    clog << "error: " << logstream::error << "L4 files are created with the first CPU run of the night" << std::endl;
+    delete cpu_file_header;
+    return 1;
   }
   this->RunAccess = new Access(this->CpuFile);
 
@@ -172,6 +219,11 @@ int DataAcquisition::CreateCpuRun(RunType run_type, std::shared_ptr<Config> Conf
   this->RunAccess->WriteToSynchFile<CpuFileHeader *>(cpu_file_header, SynchronisedFile::CONSTANT, ConfigOut);
   delete cpu_file_header;
   
+  /* quick-look file to go with the main data */
+  if (run_type == CPU) {
+    CreateQlRun(ConfigOut, CmdLine);
+  }
+  
   /* notify the AnalogManager */
   /* is reset in CloseCpuRun() */
   this->Analog->cpu_file_is_set = true;
@@ -180,6 +232,39 @@ int DataAcquisition::CreateCpuRun(RunType run_type, std::shared_ptr<Config> Conf
   return 0;
 }
 
+/**
+ * make a quick-look file for a new CPU run
+ * @param ConfigOut the output of configuration parsing with ConfigManager
+ * @param CmdLine the command line parameters
+ * the quick-look packets share their pkt_num with the CPU_PACKETs of the main file,
+ * and the file name is that of the main file, so that one can be found from the other
+ */
+int DataAcquisition::CreateQlRun(std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine) {
+
+  CpuFileHeader * ql_file_header = new CpuFileHeader();
+
+  this->cpu_ql_file_name = this->cpu_main_file_name;
+  this->cpu_ql_file_name.replace(this->cpu_ql_file_name.rfind("CPU_RUN_MAIN"), 12, "CPU_RUN_QL");
+  clog << "info: " << logstream::info << "Set cpu_ql_file_name to: " << cpu_ql_file_name << std::endl;
+  this->QlFile = std::make_shared<SynchronisedFile>(this->cpu_ql_file_name);
+  this->QlAccess = new Access(this->QlFile);
+
+  ql_file_header->header = CpuTools::BuildCpuHeader(QL_FILE_TYPE, QL_FILE_VER);
+  std::string run_info_string = BuildCpuFileInfo(ConfigOut, CmdLine);
+  strncpy(ql_file_header->run_info, run_info_string.c_str(), (size_t)run_info_string.length());
+  if (CmdLine->single_run) {
+    ql_file_header->run_size = CmdLine->acq_len;
+  }
+  else {
+    ql_file_header->run_size = RUN_SIZE;
+  }
+
+  this->QlAccess->WriteToSynchFile<CpuFileHeader *>(ql_file_header, SynchronisedFile::CONSTANT, ConfigOut);
+  delete ql_file_header;
+
+  return 0;
+}
+
 /**
  * close the CPU file run and append CRC.
  * this closes the run and runs a CRC calculation which is 
@@ -211,6 +296,150 @@ int DataAcquisition::CloseCpuRun(RunType run_type) {
 
   /* reset for AnalogManager */
   this->Analog->cpu_file_is_set = false;
+
+  /* close the quick-look file and image, update the pixel mask and save the calibration */
+  if (run_type == CPU) {
+    CloseQlRun();
+    this->QlMap.Close(&this->Calib);
+    this->PixelMon.WriteMask();
+    this->Calib.Save();
+  }
+  
+  return 0;
+}
+
+/**
+ * close the quick-look file and append CRC
+ */
+int DataAcquisition::CloseQlRun() {
+
+  if (this->QlAccess == NULL) {
+    return 1;
+  }
+  
+  CpuFileTrailer * ql_file_trailer = new CpuFileTrailer();
+  
+  clog << "info: " << logstream::info << "closing the quick-look file called " << this->QlFile->path << std::endl;
+
+  ql_file_trailer->header = CpuTools::BuildCpuHeader(TRAILER_PACKET_TYPE, QL_FILE_VER);
+  ql_file_trailer->run_size = RUN_SIZE;
+  ql_file_trailer->crc = this->QlAccess->GetChecksum(); 
+
+  this->QlAccess->WriteToSynchFile<CpuFileTrailer *>(ql_file_trailer, SynchronisedFile::CONSTANT);
+  delete ql_file_trailer;
+  
+  this->QlAccess->CloseSynchFile();
+  delete this->QlAccess;
+  this->QlAccess = NULL;
+  
+  return 0;
+}
+
+
+/**
+ * make a light-curve file for the night
+ * @param ConfigOut the output of configuration parsing with ConfigManager
+ * @param CmdLine the command line parameters
+ * the run_size is only known when the file is closed, and is 0 in the header
+ */
+int DataAcquisition::CreateLcRun(std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine) {
+
+  CpuFileHeader * lc_file_header = new CpuFileHeader();
+
+  this->cpu_lc_file_name = CreateCpuRunName(LC, ConfigOut, CmdLine);
+  clog << "info: " << logstream::info << "Set cpu_lc_file_name to: " << cpu_lc_file_name << std::endl;
+  this->LcFile = std::make_shared<SynchronisedFile>(this->cpu_lc_file_name);
+  this->LcAccess = new Access(this->LcFile);
+  this->_n_lc_pkts = 0;
+
+  lc_file_header->header = CpuTools::BuildCpuHeader(LC_FILE_TYPE, LC_FILE_VER);
+  std::string run_info_string = BuildCpuFileInfo(ConfigOut, CmdLine);
+  strncpy(lc_file_header->run_info, run_info_string.c_str(), (size_t)run_info_string.length());
+  lc_file_header->run_size = 0;
+
+  this->LcAccess->WriteToSynchFile<CpuFileHeader *>(lc_file_header, SynchronisedFile::CONSTANT, ConfigOut);
+  delete lc_file_header;
+
+  return 0;
+}
+
+/**
+ * close the light-curve file and append CRC
+ */
+int DataAcquisition::CloseLcRun() {
+
+  if (this->LcAccess == NULL) {
+    return 1;
+  }
+  
+  CpuFileTrailer * lc_file_trailer = new CpuFileTrailer();
+  
+  clog << "info: " << logstream::info << "closing the light-curve file called " << this->LcFile->path << std::endl;
+
+  lc_file_trailer->header = CpuTools::BuildCpuHeader(TRAILER_PACKET_TYPE, LC_FILE_VER);
+  lc_file_trailer->run_size = this->_n_lc_pkts;
+  lc_file_trailer->crc = this->LcAccess->GetChecksum(); 
+
+  this->LcAccess->WriteToSynchFile<CpuFileTrailer *>(lc_file_trailer, SynchronisedFile::CONSTANT);
+  delete lc_file_trailer;
+  
+  this->LcAccess->CloseSynchFile();
+  delete this->LcAccess;
+  this->LcAccess = NULL;
+  
+  return 0;
+}
+
+/**
+ * make an L4 file for the night, with the integrated D3 data of each packet
+ * @param ConfigOut the output of configuration parsing with ConfigManager
+ * @param CmdLine the command line parameters
+ * the run_size is only known when the file is closed, and is 0 in the header
+ */
+int DataAcquisition::CreateL4Run(std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine) {
+
+  CpuFileHeader * l4_file_header = new CpuFileHeader();
+
+  this->cpu_l4_file_name = CreateCpuRunName(L4, ConfigOut, CmdLine);
+  clog << "info: " << logstream::info << "Set cpu_l4_file_name to: " << cpu_l4_file_name << std::endl;
+  this->L4File = std::make_shared<SynchronisedFile>(this->cpu_l4_file_name);
+  this->L4Access = new Access(this->L4File);
+  this->_n_l4_pkts = 0;
+
+  l4_file_header->header = CpuTools::BuildCpuHeader(L4_FILE_TYPE, L4_FILE_VER);
+  std::string run_info_string = BuildCpuFileInfo(ConfigOut, CmdLine);
+  strncpy(l4_file_header->run_info, run_info_string.c_str(), (size_t)run_info_string.length());
+  l4_file_header->run_size = 0;
+
+  this->L4Access->WriteToSynchFile<CpuFileHeader *>(l4_file_header, SynchronisedFile::CONSTANT, ConfigOut);
+  delete l4_file_header;
+
+  return 0;
+}
+
+/**
+ * close the L4 file and append CRC
+ */
+int DataAcquisition::CloseL4Run() {
+
+  if (this->L4Access == NULL) {
+    return 1;
+  }
+  
+  CpuFileTrailer * l4_file_trailer = new CpuFileTrailer();
+  
+  clog << "info: " << logstream::info << "closing the L4 file called " << this->L4File->path << std::endl;
+
+  l4_file_trailer->header = CpuTools::BuildCpuHeader(TRAILER_PACKET_TYPE, L4_FILE_VER);
+  l4_file_trailer->run_size = this->_n_l4_pkts;
+  l4_file_trailer->crc = this->L4Access->GetChecksum(); 
+
+  this->L4Access->WriteToSynchFile<CpuFileTrailer *>(l4_file_trailer, SynchronisedFile::CONSTANT);
+  delete l4_file_trailer;
+  
+  this->L4Access->CloseSynchFile();
+  delete this->L4Access;
+  this->L4Access = NULL;
   
   return 0;
 }
@@ -218,51 +447,240 @@ int DataAcquisition::CloseCpuRun(RunType run_type) {
 
 /**
  * read out an scurve file into an SC_PACKET. 
+ * @param sc_file_name the scurve file from the Zynq
+ * @param start @param step @param stop @param acc the scan sent to ZynqManager::Scurve()
+ * only the acquired thresholds are kept
  */
-SC_PACKET * DataAcquisition::ScPktReadOut(std::string sc_file_name, std::shared_ptr<Config> ConfigOut) {
+SC_PACKET * DataAcquisition::ScPktReadOut(std::string sc_file_name, int start, int step, int stop, int acc) {
 
-  FILE * ptr_scfile;
   SC_PACKET * sc_packet = new SC_PACKET();
-  const char * kScFileName = sc_file_name.c_str();
-  size_t check;
+  uint32_t n_thresholds = 0;
 
   clog << "info: " << logstream::info << "reading out the file " << sc_file_name << std::endl;
   
   /* prepare the scurve packet */
   sc_packet->sc_packet_header.header = CpuTools::BuildCpuHeader(SC_PACKET_TYPE, SC_PACKET_VER);
-  sc_packet->sc_packet_header.pkt_size = sizeof(SC_PACKET);
   sc_packet->sc_time.cpu_time_stamp = CpuTools::BuildCpuTimeStamp();
-  sc_packet->sc_start = ConfigOut->scurve_start;
-  sc_packet->sc_step = ConfigOut->scurve_step;
-  sc_packet->sc_stop = ConfigOut->scurve_stop;
-  sc_packet->sc_acc = ConfigOut->scurve_acc;
+  sc_packet->sc_start = start;
+  sc_packet->sc_step = step;
+  sc_packet->sc_stop = stop;
+  sc_packet->sc_acc = acc;
+
+  /* number of thresholds acquired by the Zynq */
+  if (step > 0 && stop >= start) {
+    n_thresholds = (stop - start) / step + 1;
+  }
+  if (n_thresholds > NMAX_OF_THESHOLDS) {
+    n_thresholds = NMAX_OF_THESHOLDS;
+  }
+
+  /* check the file holds all the requested thresholds */
+  uint32_t file_size = CpuTools::FileSize(sc_file_name);
+  uint32_t n_rows = 0;
+  if (file_size > sizeof(ZynqBoardHeader)) {
+    n_rows = (file_size - sizeof(ZynqBoardHeader)) / sizeof(ScThresholdRow);
+  }
+  if (n_rows < n_thresholds) {
+    clog << "error: " << logstream::error << sc_file_name << " holds " << n_rows
+	 << " thresholds, expected " << n_thresholds << std::endl;
+    n_thresholds = n_rows;
+  }
+  
+  sc_packet->N = n_thresholds;
+  sc_packet->sc_thresholds.resize(n_thresholds);
+  for (uint32_t i = 0; i < n_thresholds; i++) {
+    sc_packet->sc_thresholds[i] = start + i * step;
+  }
+  sc_packet->sc_data.resize(n_thresholds);
+  sc_packet->sc_packet_header.pkt_size = SC_PACKET_HEADER_SIZE
+    + n_thresholds * (sizeof(uint16_t) + sizeof(ScThresholdRow));
 
-  ptr_scfile = fopen(kScFileName, "rb");
-  if (!ptr_scfile) {
+  std::ifstream sc_file(sc_file_name, std::ios::binary);
+  if (!sc_file) {
     clog << "error: " << logstream::error << "cannot open the file " << sc_file_name << std::endl;
+    delete sc_packet;
     return NULL;
   }
 
-  /* read out the scurve data from the file */
-  check = fread(&sc_packet->sc_data, sizeof(sc_packet->sc_data), 1, ptr_scfile);
-  if (check != 1) {
-    clog << "error: " << logstream::error << "fread from " << sc_file_name << " failed" << std::endl;
+  /* read out the zbh */
+  sc_file.read(reinterpret_cast<char*>(&sc_packet->zbh), sizeof(ZynqBoardHeader));
 
-    /* debug */
-    std::cout << "sizeof sc_packet->sc_data: " << (int)sizeof(sc_packet->sc_data) << std::endl;
-    std::cout << "check: " << check << std::endl;
-    std::cout << "feof: " << feof(ptr_scfile) << std::endl;
-    std::cout << "ferror: " << ferror(ptr_scfile) << std::endl;
- 
+  /* read out the acquired thresholds, the rest of the file is padding */
+  sc_file.read(reinterpret_cast<char*>(sc_packet->sc_data.data()), n_thresholds * sizeof(ScThresholdRow));
+  if (!sc_file) {
+    clog << "error: " << logstream::error << "read from " << sc_file_name << " failed" << std::endl;
+    delete sc_packet;
     return NULL;   
   }
  
   /* close the scurve file */
-  fclose(ptr_scfile);
+  sc_file.close();
+  
+  return sc_packet;
+}
+
+/**
+ * merge partial S-curves into a single SC_PACKET
+ * @param sc_packets the partial S-curves, taken with the same accumulation (not modified)
+ * the thresholds are sorted, and a threshold acquired more than once is taken from the last packet
+ */
+SC_PACKET * DataAcquisition::MergeScPkt(std::vector<SC_PACKET *> sc_packets) {
+
+  SC_PACKET * sc_packet = new SC_PACKET();
+  
+  /* threshold -> (packet, row), later packets win */
+  std::map<uint16_t, std::pair<SC_PACKET *, uint32_t>> rows;
+  uint16_t step = 0;
+  for (auto pkt : sc_packets) {
+    for (uint32_t i = 0; i < pkt->sc_data.size(); i++) {
+      rows[(uint16_t)ScurveAnalysis::Threshold(pkt, i)] = std::make_pair(pkt, i);
+    }
+    if (pkt->sc_step > 0 && (step == 0 || pkt->sc_step < step)) {
+      step = pkt->sc_step;
+    }
+  }
+  
+  if (rows.size() > NMAX_OF_THESHOLDS || sc_packets.empty()) {
+    clog << "error: " << logstream::error << "cannot merge " << rows.size() << " thresholds" << std::endl;
+    delete sc_packet;
+    return NULL;
+  }
+
+  sc_packet->sc_packet_header.header = CpuTools::BuildCpuHeader(SC_PACKET_TYPE, SC_PACKET_VER);
+  sc_packet->sc_time = sc_packets[0]->sc_time;
+  sc_packet->sc_start = rows.empty() ? 0 : rows.begin()->first;
+  sc_packet->sc_stop = rows.empty() ? 0 : rows.rbegin()->first;
+  sc_packet->sc_step = step;
+  sc_packet->sc_acc = sc_packets[0]->sc_acc;
+  sc_packet->zbh = sc_packets[0]->zbh;
+  sc_packet->N = rows.size();
+  sc_packet->sc_packet_header.pkt_size = SC_PACKET_HEADER_SIZE
+    + sc_packet->N * (sizeof(uint16_t) + sizeof(ScThresholdRow));
+
+  sc_packet->sc_thresholds.reserve(sc_packet->N);
+  sc_packet->sc_data.resize(sc_packet->N);
+  uint32_t j = 0;
+  for (auto & row : rows) {
+    sc_packet->sc_thresholds.push_back(row.first);
+    sc_packet->sc_data[j] = row.second.first->sc_data[row.second.second];
+    j++;
+  }
+  
+  return sc_packet;
+}
+
+/**
+ * read the SC_PACKET back from a CPU_RUN_SC file
+ * @param cpu_sc_file_name path to the CPU_RUN_SC file
+ * handles the full (SC_PACKET_VER 2), the compact (SC_PACKET_VER 3) and the
+ * compact packets with a list of thresholds (SC_PACKET_VER 4)
+ */
+SC_PACKET * DataAcquisition::ReadScPkt(std::string cpu_sc_file_name) {
+
+  CpuFileHeader cpu_file_header;
+  SC_PACKET * sc_packet = new SC_PACKET();
+
+  std::ifstream cpu_file(cpu_sc_file_name, std::ios::binary);
+  if (!cpu_file) {
+    clog << "error: " << logstream::error << "cannot open the file " << cpu_sc_file_name << std::endl;
+    delete sc_packet;
+    return NULL;
+  }
+
+  /* skip the file header and read out the fixed part of the packet */
+  cpu_file.read(reinterpret_cast<char*>(&cpu_file_header), sizeof(CpuFileHeader));
+  cpu_file.read(reinterpret_cast<char*>(&sc_packet->sc_packet_header), sizeof(CpuPktHeader));
+  cpu_file.read(reinterpret_cast<char*>(&sc_packet->sc_time), sizeof(CpuTimeStamp));
+  cpu_file.read(reinterpret_cast<char*>(&sc_packet->sc_start), sizeof(uint16_t));
+  cpu_file.read(reinterpret_cast<char*>(&sc_packet->sc_step), sizeof(uint16_t));
+  cpu_file.read(reinterpret_cast<char*>(&sc_packet->sc_stop), sizeof(uint16_t));
+  cpu_file.read(reinterpret_cast<char*>(&sc_packet->sc_acc), sizeof(uint16_t));
+
+  uint32_t pkt_type = (sc_packet->sc_packet_header.header >> 8) & 0xFF;
+  uint32_t pkt_ver = sc_packet->sc_packet_header.header & 0xFF;
+  if (!cpu_file || pkt_type != SC_PACKET_TYPE) {
+    clog << "error: " << logstream::error << "no SC packet found in " << cpu_sc_file_name << std::endl;
+    delete sc_packet;
+    return NULL;
+  }
+
+  if (pkt_ver >= 3) {
+
+    /* compact packet: only the acquired thresholds are stored */
+    cpu_file.read(reinterpret_cast<char*>(&sc_packet->N), sizeof(uint32_t));
+    cpu_file.read(reinterpret_cast<char*>(&sc_packet->zbh), sizeof(ZynqBoardHeader));
+    if (sc_packet->N > NMAX_OF_THESHOLDS) {
+      sc_packet->N = NMAX_OF_THESHOLDS;
+    }
+    if (pkt_ver >= 4) {
+      sc_packet->sc_thresholds.resize(sc_packet->N);
+      cpu_file.read(reinterpret_cast<char*>(sc_packet->sc_thresholds.data()), sc_packet->N * sizeof(uint16_t));
+    }
+    sc_packet->sc_data.resize(sc_packet->N);
+    cpu_file.read(reinterpret_cast<char*>(sc_packet->sc_data.data()), sc_packet->N * sizeof(ScThresholdRow));
+    
+  }
+  else {
+
+    /* full packet: keep the rows which were requested */
+    uint32_t n_thresholds = 0;
+    if (sc_packet->sc_step > 0 && sc_packet->sc_stop >= sc_packet->sc_start) {
+      n_thresholds = (sc_packet->sc_stop - sc_packet->sc_start) / sc_packet->sc_step + 1;
+    }
+    if (n_thresholds > NMAX_OF_THESHOLDS) {
+      n_thresholds = NMAX_OF_THESHOLDS;
+    }
+    sc_packet->N = n_thresholds;
+    cpu_file.read(reinterpret_cast<char*>(&sc_packet->zbh), sizeof(ZynqBoardHeader));
+    sc_packet->sc_data.resize(n_thresholds);
+    cpu_file.read(reinterpret_cast<char*>(sc_packet->sc_data.data()), n_thresholds * sizeof(ScThresholdRow));
+    
+  }
+  
+  if (!cpu_file) {
+    clog << "error: " << logstream::error << "read from " << cpu_sc_file_name << " failed" << std::endl;
+    delete sc_packet;
+    return NULL;
+  }
+
+  /* older packets are uniform scans */
+  if (sc_packet->sc_thresholds.empty()) {
+    for (uint32_t i = 0; i < sc_packet->N; i++) {
+      sc_packet->sc_thresholds.push_back(sc_packet->sc_start + i * sc_packet->sc_step);
+    }
+  }
   
   return sc_packet;
 }
 
+/**
+ * expand an SC_PACKET back to the full Zynq S-curve layout
+ * @param sc_packet the compact S-curve packet
+ * rows which were not acquired are padded with 0xFFFFFFFF, as done by the Zynq.
+ * returns NULL for an adaptive scan (SC_PACKET_VER 4), whose rows at sc_thresholds
+ * do not follow the sc_start + i * sc_step layout of the Zynq
+ */
+Z_DATA_TYPE_SCURVE_V1 * DataAcquisition::ExpandScPkt(SC_PACKET * sc_packet) {
+
+  /* older packets are always uniform, see ReadScPkt() */
+  for (uint32_t i = 0; i < sc_packet->sc_thresholds.size(); i++) {
+    if (sc_packet->sc_thresholds[i] != sc_packet->sc_start + i * sc_packet->sc_step) {
+      clog << "error: " << logstream::error << "cannot expand a non-uniform S-curve, threshold "
+	   << i << " is " << sc_packet->sc_thresholds[i] << std::endl;
+      return NULL;
+    }
+  }
+
+  Z_DATA_TYPE_SCURVE_V1 * sc_data = new Z_DATA_TYPE_SCURVE_V1();
+  uint32_t n_thresholds = std::min((uint32_t)sc_packet->sc_data.size(), (uint32_t)NMAX_OF_THESHOLDS);
+
+  sc_data->zbh = sc_packet->zbh;
+  std::memcpy(sc_data->payload.int32_data, sc_packet->sc_data.data(), n_thresholds * sizeof(ScThresholdRow));
+  std::memset(sc_data->payload.int32_data[n_thresholds], 0xFF,
+	      (NMAX_OF_THESHOLDS - n_thresholds) * sizeof(ScThresholdRow));
+
+  return sc_data;
+}
 
 /**
  * read out a hv file into an HV_PACKET 
@@ -456,16 +874,15 @@ HK_PACKET * DataAcquisition::AnalogPktReadOut() {
 int DataAcquisition::WriteCpuPkt(ZYNQ_PACKET * zynq_packet, HK_PACKET * hk_packet, std::shared_ptr<Config> ConfigOut) {
 
   CPU_PACKET * cpu_packet = new CPU_PACKET();
-  static unsigned int pkt_counter = 0;
 
   clog << "info: " << logstream::info << "writing new packet to " << this->cpu_main_file_name << std::endl;
   
   /* create the cpu packet header */
   cpu_packet->cpu_packet_header.header = CpuTools::BuildCpuHeader(CPU_PACKET_TYPE, CPU_PACKET_VER);
   cpu_packet->cpu_packet_header.pkt_size = sizeof(*cpu_packet);
-  cpu_packet->cpu_packet_header.pkt_num = pkt_counter; 
+  cpu_packet->cpu_packet_header.pkt_num = this->_n_cpu_pkts; 
   cpu_packet->cpu_time.cpu_time_stamp = CpuTools::BuildCpuTimeStamp();
-  hk_packet->hk_packet_header.pkt_num = pkt_counter;
+  hk_packet->hk_packet_header.pkt_num = this->_n_cpu_pkts;
 
   /* add the zynq and hk packets, checking for NULL */
   if (zynq_packet != nullptr) {
@@ -510,7 +927,7 @@ int DataAcquisition::WriteCpuPkt(ZYNQ_PACKET * zynq_packet, HK_PACKET * hk_packe
 							      SynchronisedFile::CONSTANT);
 
   delete cpu_packet; 
-  pkt_counter++;
+  this->_n_cpu_pkts++;
   
   return 0;
 }
@@ -519,16 +936,39 @@ int DataAcquisition::WriteCpuPkt(ZYNQ_PACKET * zynq_packet, HK_PACKET * hk_packe
 /**
  * write the SC_PACKET to the CPU file
  * @param sc_packet the Scurve data from the Zynq board
+ * @param ConfigOut the configuration struct output of ConfigManager
  * asynchronous writes to the CPU file are handled with the SynchronisedFile class
  */
-int DataAcquisition::WriteScPkt(SC_PACKET * sc_packet) {
+int DataAcquisition::WriteScPkt(SC_PACKET * sc_packet, std::shared_ptr<Config> ConfigOut) {
 
   static unsigned int pkt_counter = 0;
 
   clog << "info: " << logstream::info << "writing new packet to " << this->cpu_sc_file_name << std::endl;
 
   /* write the SC packet */
-  this->RunAccess->WriteToSynchFile<SC_PACKET *>(sc_packet, SynchronisedFile::CONSTANT);
+  ConfigOut->sc_n_thresholds = sc_packet->sc_data.size();
+  sc_packet->sc_packet_header.pkt_num = pkt_counter;
+  this->RunAccess->WriteToSynchFile<CpuPktHeader *>(&sc_packet->sc_packet_header,
+						    SynchronisedFile::CONSTANT);
+  this->RunAccess->WriteToSynchFile<CpuTimeStamp *>(&sc_packet->sc_time,
+						    SynchronisedFile::CONSTANT);
+  this->RunAccess->WriteToSynchFile<uint16_t *>(&sc_packet->sc_start,
+						SynchronisedFile::CONSTANT);
+  this->RunAccess->WriteToSynchFile<uint16_t *>(&sc_packet->sc_step,
+						SynchronisedFile::CONSTANT);
+  this->RunAccess->WriteToSynchFile<uint16_t *>(&sc_packet->sc_stop,
+						SynchronisedFile::CONSTANT);
+  this->RunAccess->WriteToSynchFile<uint16_t *>(&sc_packet->sc_acc,
+						SynchronisedFile::CONSTANT);
+  this->RunAccess->WriteToSynchFile<uint32_t *>(&sc_packet->N,
+						SynchronisedFile::CONSTANT);
+  this->RunAccess->WriteToSynchFile<ZynqBoardHeader *>(&sc_packet->zbh,
+						       SynchronisedFile::CONSTANT);
+  this->RunAccess->WriteToSynchFile<uint16_t *>(sc_packet->sc_thresholds.data(),
+						SynchronisedFile::VARIABLE_SC, ConfigOut);
+  this->RunAccess->WriteToSynchFile<ScThresholdRow *>(sc_packet->sc_data.data(),
+						      SynchronisedFile::VARIABLE_SC, ConfigOut);
+  
   delete sc_packet;
   pkt_counter++;
   
@@ -536,6 +976,39 @@ int DataAcquisition::WriteScPkt(SC_PACKET * sc_packet) {
 }
 
 
+/**
+ * write the SC_SUMMARY_PACKET to the CPU file
+ * @param sc_summary_packet the result of the on-board S-curve analysis
+ * asynchronous writes to the CPU file are handled with the SynchronisedFile class
+ */
+int DataAcquisition::WriteScSummaryPkt(SC_SUMMARY_PACKET * sc_summary_packet) {
+
+  static unsigned int pkt_counter = 0;
+
+  clog << "info: " << logstream::info << "writing new packet to " << this->cpu_sc_file_name << std::endl;
+
+  /* print a short summary */
+  std::cout << "S-curve analysis: median 50% point " << ScurveAnalysis::MedianHalfPoint(sc_summary_packet)
+	    << ", " << ScurveAnalysis::CountFlagged(sc_summary_packet, SC_PIXEL_DEAD) << " dead, "
+	    << ScurveAnalysis::CountFlagged(sc_summary_packet, SC_PIXEL_HOT) << " hot, "
+	    << ScurveAnalysis::CountFlagged(sc_summary_packet, SC_PIXEL_NO_TRANSITION | SC_PIXEL_EDGE)
+	    << " without transition in range" << std::endl;
+
+  /* the flat field follows the last S-curve */
+  if (this->Calib.SetGains(sc_summary_packet) == 0) {
+    this->Calib.Save();
+  }
+
+  /* write the SC summary packet */
+  sc_summary_packet->sc_summary_packet_header.pkt_num = pkt_counter;
+  this->RunAccess->WriteToSynchFile<SC_SUMMARY_PACKET *>(sc_summary_packet, SynchronisedFile::CONSTANT);
+  delete sc_summary_packet;
+  pkt_counter++;
+  
+  return 0;
+}
+
+
 /**
  * write the HV_PACKET to the CPU file 
  * @param hv_packet HV data from the Zynq board
@@ -566,6 +1039,91 @@ int DataAcquisition::WriteHvPkt(HV_PACKET * hv_packet, std::shared_ptr<Config> C
 }
 
 
+/**
+ * write the STATS_PACKET to the quick-look file
+ * @param stats_packet statistics of the last ZYNQ_PACKET
+ * @param pkt_num pkt_num of the CPU_PACKET holding the same ZYNQ_PACKET
+ */
+int DataAcquisition::WriteStatsPkt(STATS_PACKET * stats_packet, uint32_t pkt_num) {
+
+  if (this->QlAccess == NULL) {
+    delete stats_packet;
+    return 1;
+  }
+  
+  clog << "info: " << logstream::info << "writing new packet to " << this->cpu_ql_file_name << std::endl;
+
+  stats_packet->stats_packet_header.pkt_num = pkt_num;
+  this->QlAccess->WriteToSynchFile<STATS_PACKET *>(stats_packet, SynchronisedFile::CONSTANT);
+
+  delete stats_packet;
+  
+  return 0;
+}
+
+
+/**
+ * write the FLAGS_PACKET to the quick-look file, after the STATS_PACKET
+ * @param flags_packet classification of the D1 and D2 blocks of the last ZYNQ_PACKET
+ * @param pkt_num pkt_num of the CPU_PACKET holding the same ZYNQ_PACKET
+ */
+int DataAcquisition::WriteFlagsPkt(FLAGS_PACKET * flags_packet, uint32_t pkt_num) {
+
+  if (this->QlAccess == NULL) {
+    delete flags_packet;
+    return 1;
+  }
+  
+  flags_packet->flags_packet_header.pkt_num = pkt_num;
+  this->QlAccess->WriteToSynchFile<FLAGS_PACKET *>(flags_packet, SynchronisedFile::CONSTANT);
+
+  delete flags_packet;
+  
+  return 0;
+}
+
+
+/**
+ * append the LC_PACKET to the light-curve file
+ * @param lc_packet light curve of the last ZYNQ_PACKET
+ */
+int DataAcquisition::WriteLcPkt(LC_PACKET * lc_packet) {
+
+  if (this->LcAccess == NULL) {
+    delete lc_packet;
+    return 1;
+  }
+  
+  lc_packet->lc_packet_header.pkt_num = this->_n_lc_pkts;
+  this->LcAccess->WriteToSynchFile<LC_PACKET *>(lc_packet, SynchronisedFile::CONSTANT);
+
+  delete lc_packet;
+  this->_n_lc_pkts++;
+  
+  return 0;
+}
+
+/**
+ * append the L4_PACKET to the L4 file
+ * @param l4_packet integrated D3 data of the last ZYNQ_PACKET
+ */
+int DataAcquisition::WriteL4Pkt(L4_PACKET * l4_packet) {
+
+  if (this->L4Access == NULL) {
+    delete l4_packet;
+    return 1;
+  }
+  
+  l4_packet->l4_packet_header.pkt_num = this->_n_l4_pkts;
+  this->L4Access->WriteToSynchFile<L4_PACKET *>(l4_packet, SynchronisedFile::CONSTANT);
+
+  delete l4_packet;
+  this->_n_l4_pkts++;
+  
+  return 0;
+}
+
+
 /**
  * Poll the lftp server on the Zynq to check for new files.
  * Also clears old files from lftp server before starting.
@@ -594,7 +1152,7 @@ void DataAcquisition::FtpPoll(bool monitor) {
     /* build the command */
     conv1 << "lftp -u minieusouser,minieusopass -e "
 	  << "\"set ftp:passive-mode off;mrm *;quit\""
-	  << " 192.168.7.10" << "> /dev/null 2>&1" << std::endl;
+	  << " " << this->zynq_ip << "> /dev/null 2>&1" << std::endl;
       
     /* convert stringstream to char * */
     ftp_clear_str = conv1.str();
@@ -608,7 +1166,7 @@ void DataAcquisition::FtpPoll(bool monitor) {
   clog << "info: " << logstream::info << "starting FTP server polling" << std::endl;
   
   /* build the command */
-  conv2 << "wget ftp://192.168.7.10/* -P /home/minieusouser/DATA --no-passive-ftp --timeout=3 "
+  conv2 << "wget ftp://" << this->zynq_ip << "/* -P " << this->data_dir << " --no-passive-ftp --timeout=3 "
 	<< "> /dev/null 2>&1" << std::endl;
   
   /* convert stringstream to char * */
@@ -654,7 +1212,7 @@ int DataAcquisition::ProcessIncomingData(std::shared_ptr<Config> ConfigOut, CmdL
   std::string zynq_file_name;
   std::string sc_file_name;
   std::string hv_file_name;
-  std::string data_str(DATA_DIR);
+  std::string data_str(this->data_dir);
   std::string event_name;
 
   clog << "info: " << logstream::info << "starting background process of processing incoming data" << std::endl;
@@ -666,12 +1224,13 @@ int DataAcquisition::ProcessIncomingData(std::shared_ptr<Config> ConfigOut, CmdL
   }
 
   /* watch the data directory for incoming files */
-  clog << "info: " << logstream::info << "start watching " << DATA_DIR << std::endl;
-  wd = inotify_add_watch(fd, DATA_DIR, IN_CLOSE_WRITE);
+  clog << "info: " << logstream::info << "start watching " << data_str << std::endl;
+  wd = inotify_add_watch(fd, data_str.c_str(), IN_CLOSE_WRITE);
 
   /* to keep track of good and bad packets */
   int packet_counter = 0;
   int bad_packet_counter = 0;
+  int sc_retries = 0;
 
   /* initilaise timeout timer */
   time_t start = time(0);
@@ -747,6 +1306,14 @@ int DataAcquisition::ProcessIncomingData(std::shared_ptr<Config> ConfigOut, CmdL
 		  /* create a new run */
 		  CreateCpuRun(CPU, ConfigOut, CmdLine);
 
+		  /* the light curve and L4 files cover the whole night */
+		  if (this->LcAccess == NULL) {
+		    CreateLcRun(ConfigOut, CmdLine);
+		  }
+		  if (this->L4Access == NULL) {
+		    CreateL4Run(ConfigOut, CmdLine);
+		  }
+
 		  /* reset first_loop status */
 		  if (first_loop) {
 		    first_loop = false;
@@ -761,8 +1328,26 @@ int DataAcquisition::ProcessIncomingData(std::shared_ptr<Config> ConfigOut, CmdL
 		/* check for NULL packets */
 		if ((zynq_packet != nullptr) && (hk_packet != nullptr)) {
 	      
+		  /* statistics before the zynq packet is written and deleted, */
+		  /* numbered by the CPU_PACKET that will hold it */
+		  /* the D3 sum of each pixel is computed once, in the L4 packet */
+		  uint32_t pkt_num = this->_n_cpu_pkts;
+		  L4_PACKET * l4_packet = LightCurve::Integrate(zynq_packet);
+		  STATS_PACKET * stats_packet = PacketStats::Compute(zynq_packet, l4_packet->int_data);
+		  this->PixelMon.Update(zynq_packet, ConfigOut->pixel_mask_n_sigma, ConfigOut->pixel_mask_persist);
+		  LC_PACKET * lc_packet = LightCurve::Extract(zynq_packet);
+		  this->Rates.Update(zynq_packet, pkt_num);
+		  FLAGS_PACKET * flags_packet = TransientClassifier::Classify(zynq_packet);
+		  this->Tracks.Push(zynq_packet, this->cpu_tracks_file_name, pkt_num);
+		  this->Calib.Update(l4_packet->int_data);
+		  this->QlMap.Add(zynq_packet, l4_packet->int_data, pkt_num, &this->Calib);
+		  
 		  /* generate cpu packet and append to file */
 		  WriteCpuPkt(zynq_packet, hk_packet, ConfigOut);
+		  WriteStatsPkt(stats_packet, pkt_num);
+		  WriteFlagsPkt(flags_packet, pkt_num);
+		  WriteLcPkt(lc_packet);
+		  WriteL4Pkt(l4_packet);
 	      
 		  /* delete upon completion */
 		  if (!CmdLine->keep_zynq_pkt) {
@@ -817,21 +1402,37 @@ int DataAcquisition::ProcessIncomingData(std::shared_ptr<Config> ConfigOut, CmdL
 	    
 	      sc_file_name = data_str + "/" + event->name;
 
-	      /* wait for scurve completion */
-	      std::unique_lock<std::mutex> sc_lock(this->_m_scurve);
-	      while(!this->_cv_scurve.wait_for(sc_lock,
-					       std::chrono::milliseconds(WAIT_PERIOD),
-					       [this] { return this->_scurve; })) {}	
-	      sleep(1);
+	      /* the FTP server is polled during the scan, so the file can be fetched while the Zynq writes it */
+	      uint32_t n_thresholds = 0;
+	      if (ConfigOut->scurve_step > 0 && ConfigOut->scurve_stop >= ConfigOut->scurve_start) {
+		n_thresholds = std::min((ConfigOut->scurve_stop - ConfigOut->scurve_start) / ConfigOut->scurve_step + 1,
+					NMAX_OF_THESHOLDS);
+	      }
+	      uint32_t sc_file_size = sizeof(ZynqBoardHeader) + n_thresholds * sizeof(ScThresholdRow);
+	      if (CpuTools::FileSize(sc_file_name) < sc_file_size && sc_retries < SC_FILE_RETRIES) {
+		clog << "info: " << logstream::info << sc_file_name << " is not complete, fetching it again" << std::endl;
+		std::remove(sc_file_name.c_str());
+		sc_retries++;
+		event_number += EVENT_SIZE + event->len;
+		continue;
+	      }
 	      std::cout << "S-curve acquisition complete" << std::endl;
 	      
 	      CreateCpuRun(SC, ConfigOut, CmdLine);
 	      
 	      /* generate sc packet and append to file */
-	      SC_PACKET * sc_packet = ScPktReadOut(sc_file_name, ConfigOut);
+	      SC_PACKET * sc_packet = ScPktReadOut(sc_file_name, ConfigOut->scurve_start, ConfigOut->scurve_step,
+						   ConfigOut->scurve_stop, ConfigOut->scurve_acc);
 
 	      if (sc_packet != NULL) {
-		WriteScPkt(sc_packet);
+
+		/* analyse before the packet is written and deleted */
+		SC_SUMMARY_PACKET * sc_summary_packet = ScurveAnalysis::Analyse(sc_packet);
+		WriteScPkt(sc_packet, ConfigOut);
+
+		if (sc_summary_packet != NULL) {
+		  WriteScSummaryPkt(sc_summary_packet);
+		}
 	      }
 
 	      /* print update to screen */
@@ -847,6 +1448,7 @@ int DataAcquisition::ProcessIncomingData(std::shared_ptr<Config> ConfigOut, CmdL
 	      /* exit without waiting for more files */
 	      /* send shutdown signal to RunInstrument */
 	      /* interrupt signal to main thread */
+	      this->SignalScurveDone();
 	      pthread_kill((pthread_t)main_thread, SIGINT);   
 	      return 0;
 	    
@@ -906,6 +1508,12 @@ int DataAcquisition::ProcessIncomingData(std::shared_ptr<Config> ConfigOut, CmdL
   /* stop watching the directory */
   inotify_rm_watch(fd, wd);
   close(fd);
+
+  /* do not leave CollectSc() waiting for a file which did not come */
+  if (scurve) {
+    clog << "error: " << logstream::error << "no S-curve file was read out" << std::endl;
+    this->SignalScurveDone();
+  }
 #endif /* #ifndef __APPLE__ */
   return 0;
 }
@@ -918,7 +1526,7 @@ int DataAcquisition::ProcessIncomingData(std::shared_ptr<Config> ConfigOut, CmdL
  */
 int DataAcquisition::GetHvInfo(std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine) {
 
-  std::string data_str(DATA_DIR);
+  std::string data_str(this->data_dir);
 
   std::cout << "waiting for HV file... (NB: soon to be removed with FW update)" << std::endl;
 
@@ -1000,39 +1608,269 @@ bool DataAcquisition::IsScurveDone() {
 int DataAcquisition::CollectSc(ZynqManager * Zynq, std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine) {
 #ifndef __APPLE__
 
+  this->_zynq = Zynq;
+
   long unsigned int main_thread = pthread_self();
 
-  /* tell zynq to gather Scurve */
-  {
-    std::unique_lock<std::mutex> lock(Zynq->m_zynq);  
-    Zynq->Scurve(ConfigOut->scurve_start, ConfigOut->scurve_step, ConfigOut->scurve_stop, ConfigOut->scurve_acc);
-  }
+  // Debug
+  clog << "info: " << logstream::info << "launching FtpPoll() from CollectSc()" << std::endl;
+  std::cout << "Now polling FTP server, please wait..." << std::endl; 
+    
+  /* FTP polling during the scan, the old files are cleared first */
+  std::thread ftp_poll (&DataAcquisition::FtpPoll, this, true);
 
   // Debug
   clog << "info: " << logstream::info << "launching ProcessInocmingData() from CollectSc()" << std::endl;
   
-  /* collect the data */
+  /* collect the data, returns once the Scurve file is read out */
   std::thread collect_data (&DataAcquisition::ProcessIncomingData, this, ConfigOut, CmdLine, main_thread, true);
 
-  // Debug
-  clog << "info: " << logstream::info << "launching FtpPoll() from CollectSc()" << std::endl;
-  std::cout << "Now polling FTP server, please wait..." << std::endl; 
-    
-  /* FTP polling */
-  std::thread ftp_poll (&DataAcquisition::FtpPoll, this, false);
+  /* tell zynq to gather Scurve */
+  auto start_time = std::chrono::steady_clock::now();
+  Zynq->StartScurve(ConfigOut->scurve_start, ConfigOut->scurve_step, ConfigOut->scurve_stop, ConfigOut->scurve_acc);
+  auto deadline = start_time + std::chrono::milliseconds(SCURVE_FILE_WAIT_MS)
+    + ZynqManager::ScurveDuration(ConfigOut->scurve_start, ConfigOut->scurve_step,
+				  ConfigOut->scurve_stop, ConfigOut->scurve_acc);
+
+  /* the status is only asked for if the file is late, until the scan is complete */
+  std::unique_lock<std::mutex> lock(this->_m_scurve);
+  while (!this->_cv_scurve.wait_until(lock, deadline, [this] { return this->_scurve; })) {
+
+    lock.unlock();
+    bool sc_complete = Zynq->CheckScurve();
+    lock.lock();
+
+    if (sc_complete) {
+      clog << "info: " << logstream::info << "S-curve complete, waiting for its file" << std::endl;
+      this->_cv_scurve.wait(lock, [this] { return this->_scurve; });
+      break;
+    }
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SCURVE_POLL_MS);
+  }
+  lock.unlock();
+
+  clog << "info: " << logstream::info << "stopping FtpPoll() and waiting for ProcessIncomingData() to join" << std::endl;
+  std::cout << "Waiting for data collection to complete..." << std::endl; 
+
+  /* stop the FTP polling */
+  {
+    std::unique_lock<std::mutex> ftp_lock(this->_m_ftp);
+    this->_ftp = true;
+  } /* release mutex */
+  this->_cv_ftp.notify_all();
+  
+  /* join remaining threads */
+  collect_data.join();
   ftp_poll.join();
+  
+#endif /* __APPLE__ */
+  return 0;
+}
+
+/**
+ * take an S-curve and read it out directly, without a ProcessIncomingData() thread
+ * @param Zynq object to control the Zynq subsystem passed from RunInstrument
+ * @param start @param step @param stop @param acc the scan to send to ZynqManager::Scurve()
+ * @param CmdLine output of command line options parsing with InputParser
+ * returns a new SC_PACKET or NULL on failure
+ */
+SC_PACKET * DataAcquisition::AcquireScPkt(ZynqManager * Zynq, int start, int step, int stop, int acc, CmdLineInputs * CmdLine) {
+
+  std::string data_str(this->data_dir);
+  std::string sc_file_name = "";
+
+  /* clear the previous scan from the FTP server, ZynqManager::Scurve() returns on completion */
+  Zynq->InstrumentClean();
+  Zynq->Scurve(start, step, stop, acc);
+  FtpPoll(false);
+
+  /* find the scurve file */
+  DIR * dir;
+  if ((dir = opendir(data_str.c_str())) != NULL) {
+
+    struct dirent * ent;
+    while ((ent = readdir(dir)) != NULL) {
+
+      std::string fname(ent->d_name);
+      if ( (fname.compare(0, 2, "sc") == 0) && (fname.length() > 3) &&
+	   (fname.compare(fname.length() - 3, 3, "dat") == 0) ) {
+	sc_file_name = data_str + "/" + fname;
+      }
+    }
+    closedir(dir);
+  }
+  if (sc_file_name.empty()) {
+    clog << "error: " << logstream::error << "no scurve file found in " << data_str << std::endl;
+    std::cout << "ERROR: no scurve file found in " << data_str << std::endl;
+    return NULL;
+  }
+
+  SC_PACKET * sc_packet = ScPktReadOut(sc_file_name, start, step, stop, acc);
 
-  clog << "info: " << logstream::info << "signalling Scurve completion to ProcessIncomingData()" << std::endl;
-  std::cout << "Signalling Scurve completion..." << std::endl; 
+  /* always remove, so that the next scan is not mixed up with this one */
+  if (CmdLine->keep_zynq_pkt) {
+    std::string kept_file_name = data_str + "/kept_" + std::to_string(start) + "_" + std::to_string(step) + "_"
+      + sc_file_name.substr(data_str.length() + 1);
+    std::rename(sc_file_name.c_str(), kept_file_name.c_str());
+  }
+  else {
+    std::remove(sc_file_name.c_str());
+  }
   
-  /* signal that scurve is done */
-  this->SignalScurveDone();
+  return sc_packet;
+}
 
-  clog << "info: " << logstream::info << "waiting for ProcessIncomingData() to join" << std::endl;
-  std::cout << "Waiting for data collection to complete..." << std::endl; 
+/**
+ * tune the ASIC DAC10 thresholds to a target noise rate
+ * @param Zynq object to control the Zynq subsystem passed from RunInstrument
+ * @param ConfigOut output of the configuration file parsing with ConfigManager
+ * @param CmdLine output of command line options parsing with InputParser
+ * a short S-curve (DAC_TUNE_ACC GTUs per threshold) is taken and stored in a CPU_RUN_SC file, 
+ * then analysed on board and the thresholds are applied with ZynqManager::SetMatrixDac10()
+ * returns 0 if the thresholds were applied
+ */
+int DataAcquisition::TuneDac(ZynqManager * Zynq, std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine) {
+
+  std::vector<int> dac10_values;
+  auto start_time = std::chrono::steady_clock::now();
+
+  clog << "info: " << logstream::info << "tuning the ASIC DAC to " << ConfigOut->dac_tune_rate << " Hz" << std::endl;
+  std::cout << "Tuning the ASIC DAC to " << ConfigOut->dac_tune_rate << " Hz, please wait..." << std::endl;
+
+  /* take a short S-curve */
+  SC_PACKET * sc_packet = AcquireScPkt(Zynq, ConfigOut->scurve_start, ConfigOut->scurve_step,
+				       ConfigOut->scurve_stop, ConfigOut->dac_tune_acc, CmdLine);
+  if (sc_packet == NULL) {
+    std::cout << "ERROR: DAC tuning failed" << std::endl;
+    return 1;
+  }
   
-  /* join remaining thread */
-  collect_data.join();
+  /* analyse */
+  SC_SUMMARY_PACKET * sc_summary_packet = ScurveAnalysis::Analyse(sc_packet);
+  if (sc_summary_packet != NULL) {
+    dac10_values = DacTuning::ComputeDac10(sc_packet, sc_summary_packet, ConfigOut->dac_tune_rate);
+  }
+
+  /* store the calibration S-curve */
+  CreateCpuRun(SC, ConfigOut, CmdLine);
+  WriteScPkt(sc_packet, ConfigOut);
+  if (sc_summary_packet != NULL) {
+    WriteScSummaryPkt(sc_summary_packet);
+  }
+  CloseCpuRun(SC);
+  
+  if (dac10_values.empty()) {
+    std::cout << "ERROR: DAC tuning failed" << std::endl;
+    return 1;
+  }
+
+  /* apply the thresholds */
+  if (Zynq->SetMatrixDac10(dac10_values) != 0) {
+    return 1;
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+  clog << "info: " << logstream::info << "DAC tuning took " << elapsed.count() << " ms, median DAC10 "
+       << DacTuning::MedianDac10(dac10_values) << std::endl;
+  std::cout << "DAC tuned in " << elapsed.count() / 1000.0 << " s, median DAC10 is "
+	    << DacTuning::MedianDac10(dac10_values) << std::endl;
+  
+  return 0;
+}
+
+/**
+ * collect an adaptive S-curve
+ * @param Zynq object to control the Zynq subsystem passed from RunInstrument
+ * @param ConfigOut output of the configuration file parsing with ConfigManager
+ * @param CmdLine output of command line options parsing with InputParser
+ * a coarse scan with SCURVE_COARSE_STEP locates the transitions of the pixels, then 
+ * fine scans with SCURVE_STEP are taken over the windows around them only.
+ * the scans are merged into a single SC_PACKET in a CPU_RUN_SC file
+ */
+int DataAcquisition::CollectAdaptiveSc(ZynqManager * Zynq, std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine) {
+#ifndef __APPLE__
+
+  this->_zynq = Zynq;
+
+  long unsigned int main_thread = pthread_self();
+  std::vector<SC_PACKET *> sc_packets;
+  int start = ConfigOut->scurve_start;
+  int stop = ConfigOut->scurve_stop;
+  int fine_step = ConfigOut->scurve_step;
+  int coarse_step = std::max(ConfigOut->scurve_coarse_step, fine_step);
+  int n_acquired = 0;
+  auto start_time = std::chrono::steady_clock::now();
+
+  /* coarse pass */
+  clog << "info: " << logstream::info << "adaptive S-curve: coarse pass with step " << coarse_step << std::endl;
+  std::cout << "Adaptive S-curve: coarse pass with step " << coarse_step << ", please wait..." << std::endl;
+  SC_PACKET * coarse_packet = AcquireScPkt(Zynq, start, coarse_step, stop, ConfigOut->scurve_acc, CmdLine);
+  if (coarse_packet == NULL) {
+    return 1;
+  }
+  sc_packets.push_back(coarse_packet);
+  n_acquired += coarse_packet->sc_data.size();
+
+  /* find the transitions */
+  SC_SUMMARY_PACKET * coarse_summary = ScurveAnalysis::Analyse(coarse_packet);
+  std::vector<std::pair<int, int>> windows;
+  if (coarse_summary != NULL) {
+
+    /* NB: pad by a coarse step as the coarse widths are not resolved */
+    windows = ScurveAnalysis::TransitionWindows(coarse_summary, SC_WINDOW_N_SIGMA, coarse_step);
+    delete coarse_summary;
+  }
+
+  /* fine passes, on the grid of a uniform fine scan */
+  if (fine_step < coarse_step) {
+    for (auto & w : windows) {
+
+      int low = std::max(start, w.first - coarse_step);
+      int high = std::min(stop, w.second + coarse_step);
+      low = start + ((low - start) / fine_step) * fine_step;
+      if (high <= low) {
+	continue;
+      }
+      
+      clog << "info: " << logstream::info << "adaptive S-curve: fine pass from " << low << " to " << high << std::endl;
+      std::cout << "Adaptive S-curve: fine pass from " << low << " to " << high << std::endl;
+      SC_PACKET * fine_packet = AcquireScPkt(Zynq, low, fine_step, high, ConfigOut->scurve_acc, CmdLine);
+      if (fine_packet != NULL) {
+	sc_packets.push_back(fine_packet);
+	n_acquired += fine_packet->sc_data.size();
+      }
+    }
+  }
+  
+  /* merge and store */
+  SC_PACKET * sc_packet = MergeScPkt(sc_packets);
+  for (auto pkt : sc_packets) {
+    delete pkt;
+  }
+
+  if (sc_packet != NULL) {
+
+    int n_uniform = (fine_step > 0) ? (stop - start) / fine_step + 1 : 0;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+    clog << "info: " << logstream::info << "adaptive S-curve: " << n_acquired << " thresholds acquired in "
+	 << sc_packet->sc_data.size() << " rows, against " << n_uniform << " for a uniform scan, in "
+	 << elapsed.count() << " ms" << std::endl;
+    std::cout << "Adaptive S-curve complete: " << n_acquired << " thresholds acquired instead of "
+	      << n_uniform << std::endl;
+    
+    CreateCpuRun(SC, ConfigOut, CmdLine);
+    SC_SUMMARY_PACKET * sc_summary_packet = ScurveAnalysis::Analyse(sc_packet);
+    WriteScPkt(sc_packet, ConfigOut);
+    if (sc_summary_packet != NULL) {
+      WriteScSummaryPkt(sc_summary_packet);
+    }
+    CloseCpuRun(SC);
+    
+  }
+
+  /* signal that scurve is done and exit as for CollectSc() */
+  this->SignalScurveDone();
+  pthread_kill((pthread_t)main_thread, SIGINT);
   
 #endif /* __APPLE__ */
   return 0;
@@ -1048,35 +1886,33 @@ int DataAcquisition::CollectSc(ZynqManager * Zynq, std::shared_ptr<Config> Confi
 int DataAcquisition::CollectData(ZynqManager * Zynq, std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine) {
 #ifndef __APPLE__
 
+  this->_zynq = Zynq;
+
   long unsigned int main_thread = pthread_self();
 
   /* FTP polling */
   std::thread ftp_poll (&DataAcquisition::FtpPoll, this, true);
+
+  /* track detection in the background */
+  this->Tracks.Start(ConfigOut->track_n_sigma, ConfigOut->track_min_frames);
+  this->Rates.Start(Zynq, ConfigOut->rate_step_factor, ConfigOut->rate_action);
   
   /* collect the data */
   std::thread collect_main_data (&DataAcquisition::ProcessIncomingData, this, ConfigOut, CmdLine, main_thread, false);
   
   /* set Zynq operational mode */
   /* select number of N1 and N2 packets */
-  {
-    std::unique_lock<std::mutex> lock(Zynq->m_zynq);  
-    Zynq->SetNPkts(ConfigOut->N1, ConfigOut->N2);
-    Zynq->SetL2TrigParams(ConfigOut->L2_N_BG, ConfigOut->L2_LOW_THRESH);
-  }
+  Zynq->Run<int>([&]() {
+      return Zynq->SetNPkts(ConfigOut->N1, ConfigOut->N2)
+	+ Zynq->SetL2TrigParams(ConfigOut->L2_N_BG, ConfigOut->L2_LOW_THRESH); });
   
   if (CmdLine->test_zynq_on) {
     /* set a mode to produce test data */
-    {
-      std::unique_lock<std::mutex> lock(Zynq->m_zynq);  
-      Zynq->SetTestMode();   
-    }
+    Zynq->SetTestMode();
   }
 
   /* set a mode to start data gathering */
-  {
-    std::unique_lock<std::mutex> lock(Zynq->m_zynq);  
-    Zynq->SetZynqMode();
-  }
+  Zynq->SetZynqMode();
   
   /* add acquisition with the analog board */
   std::thread analog(&AnalogManager::ProcessAnalogData, this->Analog, ConfigOut);
@@ -1092,12 +1928,15 @@ int DataAcquisition::CollectData(ZynqManager * Zynq, std::shared_ptr<Config> Con
   if (this->CpuFile->IsOpen()) {
     CloseCpuRun(CPU);
   }
+
+  /* close the light-curve and L4 files at the end of the night */
+  CloseLcRun();
+  CloseL4Run();
+  this->Tracks.Stop();
+  this->Rates.Stop();
   
   /* stop Zynq acquisition */
-  {
-    std::unique_lock<std::mutex> lock(Zynq->m_zynq);  
-    Zynq->StopAcquisition();
-  }
+  Zynq->Run<int>([&]() { return Zynq->StopAcquisition(); }, ZynqManager::LANE_URGENT);
   
 #endif /* __APPLE__ */
   return 0;
@@ -5,17 +5,25 @@
 #include <sys/inotify.h>
 #endif /* __APPLE__ */
 #include <thread>
+#include <cstring>
+#include <algorithm>
+#include <map>
 
 #include "OperationMode.h"
 #include "ThermManager.h"
 #include "AnalogManager.h"
 #include "InputParser.h"
 #include "ConfigManager.h"
-
-#define DATA_DIR "/home/minieusouser/DATA"
-#define DONE_DIR "/home/minieusouser/DONE"
-#define USB_MOUNTPOINT_0 "/media/usb0"
-#define USB_MOUNTPOINT_1 "/media/usb1"
+#include "ScurveAnalysis.h"
+#include "DacTuning.h"
+#include "PacketStats.h"
+#include "PixelMonitor.h"
+#include "LightCurve.h"
+#include "TrackDetector.h"
+#include "TransientClassifier.h"
+#include "QuickLookMap.h"
+#include "CalibrationCache.h"
+#include "RateMonitor.h"
 
 /* maximum filename size (CPU is Ext4 but USB is FAT32) */
 #define MAX_FILENAME_LENGTH 255
@@ -28,6 +36,12 @@
 /* number of seconds to wait for HV file transfer on FTP */
 #define HV_FILE_TIMEOUT 1
 
+/* number of times an S-curve file fetched before it was complete is fetched again */
+#define SC_FILE_RETRIES 3
+
+/* half size of the fine scan windows of an adaptive S-curve, in units of the transition width */
+#define SC_WINDOW_N_SIGMA 3
+
 
 /** NIGHT operational mode: data acquisition
  * class for controlling the main acquisition 
@@ -38,7 +52,20 @@ public:
   std::string cpu_main_file_name;
   std::string cpu_sc_file_name;
   std::string cpu_hv_file_name;
+  std::string cpu_ql_file_name;
+  std::string cpu_lc_file_name;
+  std::string cpu_l4_file_name;
+  std::string cpu_tracks_file_name;
   uint8_t usb_num_storage_dev;
+  /**
+   * where the Zynq files arrive, where the run files are written with and
+   * without USB storage, and the address of the Zynq FTP server.
+   * the defaults of ConfigManager.h, set from the configuration by RunInstrument
+   */
+  std::string data_dir;
+  std::string usb_dir;
+  std::string done_dir;
+  std::string zynq_ip;
   int n_files_written;
   std::mutex m_nfiles;
   
@@ -50,6 +77,50 @@ public:
    * synchronised file access
    */
   Access * RunAccess;
+  /**
+   * quick-look file pointer, opened and closed with each CPU run
+   */
+  std::shared_ptr<SynchronisedFile> QlFile;
+  /**
+   * quick-look file access
+   */
+  Access * QlAccess;
+  /**
+   * light-curve file pointer, one file per night of acquisition
+   */
+  std::shared_ptr<SynchronisedFile> LcFile;
+  /**
+   * light-curve file access
+   */
+  Access * LcAccess;
+  /**
+   * L4 file pointer, one file per night of acquisition
+   */
+  std::shared_ptr<SynchronisedFile> L4File;
+  /**
+   * L4 file access
+   */
+  Access * L4Access;
+  /**
+   * hot and dead pixel detection, written to DeadPixelMask.txt with each CPU run
+   */
+  PixelMonitor PixelMon;
+  /**
+   * track detection in a worker thread, with a text catalogue for each CPU run
+   */
+  TrackDetector Tracks;
+  /**
+   * quick-look images of the focal surface for each packet and CPU run
+   */
+  QuickLookMap QlMap;
+  /**
+   * per-pixel background and flat field, saved with each CPU run
+   */
+  CalibrationCache Calib;
+  /**
+   * steps in the rate of each ECASIC, with an optional action on the HV
+   */
+  RateMonitor Rates;
   /**
   * output of the configuration parsing is stored here
   */
@@ -63,6 +134,9 @@ public:
     CPU = 0,
     SC = 1,
     HV = 2,
+    QL = 3,
+    LC = 4,
+    L4 = 5,
   };
 
   DataAcquisition();
@@ -70,9 +144,14 @@ public:
   int CloseCpuRun(RunType run_type);
   int CollectSc(ZynqManager * ZqManager, std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine);
   int CollectData(ZynqManager * ZqManager, std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine);
+  int CollectAdaptiveSc(ZynqManager * ZqManager, std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine);
+  int TuneDac(ZynqManager * ZqManager, std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine);
   bool IsScurveDone();
   static int WriteFakeZynqPkt();
   static int ReadFakeZynqPkt();
+  static SC_PACKET * ReadScPkt(std::string cpu_sc_file_name);
+  static Z_DATA_TYPE_SCURVE_V1 * ExpandScPkt(SC_PACKET * sc_packet);
+  static SC_PACKET * MergeScPkt(std::vector<SC_PACKET *> sc_packets);
   
 private:
   /**
@@ -80,22 +159,50 @@ private:
    */
   std::mutex _m_scurve;
   /**
-   * to wait for scurve acquisition to complete
+   * to wait for the scurve file to be read out
    */
   std::condition_variable _cv_scurve;
   /**
    * to notify a completed scurve
    */
   bool _scurve;  
+  /**
+   * Zynq interface of the acquisition, for the run info
+   */
+  ZynqManager * _zynq;
+  /**
+   * pkt_num of the next CPU_PACKET, shared by all per-packet outputs
+   */
+  uint32_t _n_cpu_pkts;
+  /**
+   * number of LC_PACKETs in the current light-curve file
+   */
+  uint32_t _n_lc_pkts;
+  /**
+   * number of L4_PACKETs in the current L4 file
+   */
+  uint32_t _n_l4_pkts;
 
   std::string CreateCpuRunName(RunType run_type, std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine);
   std::string BuildCpuFileInfo(std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine);
-  SC_PACKET * ScPktReadOut(std::string sc_file_name, std::shared_ptr<Config> ConfigOut);
+  SC_PACKET * ScPktReadOut(std::string sc_file_name, int start, int step, int stop, int acc);
+  SC_PACKET * AcquireScPkt(ZynqManager * Zynq, int start, int step, int stop, int acc, CmdLineInputs * CmdLine);
   HV_PACKET * HvPktReadOut(std::string hv_file_name, std::shared_ptr<Config> ConfigOut);
   ZYNQ_PACKET * ZynqPktReadOut(std::string zynq_file_name, std::shared_ptr<Config> ConfigOut);
   HK_PACKET * AnalogPktReadOut();
-  int WriteScPkt(SC_PACKET * sc_packet);
+  int WriteScPkt(SC_PACKET * sc_packet, std::shared_ptr<Config> ConfigOut);
+  int WriteScSummaryPkt(SC_SUMMARY_PACKET * sc_summary_packet);
   int WriteHvPkt(HV_PACKET * hv_packet, std::shared_ptr<Config> ConfigOut);
+  int WriteStatsPkt(STATS_PACKET * stats_packet, uint32_t pkt_num);
+  int WriteFlagsPkt(FLAGS_PACKET * flags_packet, uint32_t pkt_num);
+  int CreateQlRun(std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine);
+  int CloseQlRun();
+  int WriteLcPkt(LC_PACKET * lc_packet);
+  int CreateLcRun(std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine);
+  int CloseLcRun();
+  int WriteL4Pkt(L4_PACKET * l4_packet);
+  int CreateL4Run(std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine);
+  int CloseL4Run();
   int WriteCpuPkt(ZYNQ_PACKET * zynq_packet, HK_PACKET * hk_packet, std::shared_ptr<Config> ConfigOut);
   int GetHvInfo(std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine);
   int GetScurve(ZynqManager * Zynq, std::shared_ptr<Config> ConfigOut, CmdLineInputs * CmdLine);
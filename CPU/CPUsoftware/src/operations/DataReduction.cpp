@@ -13,7 +13,6 @@ DataReduction::DataReduction() {
 void DataReduction::Start() {
 
   clog << "info: " << logstream::info << "starting data reduction" << std::endl;
-  std::cout << "starting data reduction" << std::endl;
 
   /* launch thread */
   std::thread data_reduction (&DataReduction::RunDataReduction, this);
@@ -26,21 +25,494 @@ void DataReduction::Start() {
 
 /**
  * data reduction procedure 
- * compresses data into .zip files
+ * prepares the DOWNLINK file of the last night, then waits for the mode switch
  */
 int DataReduction::RunDataReduction() {
 
-  /* enter loop while instrument mode switching not requested */
+  LowerPriority();
+  SelectDownlink();
+
+  /* wait for instrument mode switching */
   std::unique_lock<std::mutex> lock(this->_m_switch); 
   while(!this->_cv_switch.wait_for(lock,
 				   std::chrono::milliseconds(WAIT_PERIOD),
 				   [this] { return this->_switch; } )) {   
-
-    std::cout << "running data reduction loop..." << std::endl;
-    sleep(1);
-    
   }
   
   return 0;
 }
 
+/**
+ * check if a mode switch was requested, to stop the data reduction early
+ */
+bool DataReduction::SwitchRequested() {
+
+  std::unique_lock<std::mutex> lock(this->_m_switch);
+  return this->_switch;
+}
+
+/**
+ * lower the priority of the calling thread, so that the data reduction
+ * does not delay the rest of the instrument control
+ */
+void DataReduction::LowerPriority() {
+
+#ifndef __APPLE__
+  if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), DOWNLINK_NICE) != 0) {
+    clog << "error: " << logstream::error << "cannot lower the priority of the data reduction" << std::endl;
+  }
+#endif /* __APPLE__ */
+
+}
+
+/**
+ * run tasks on DOWNLINK_N_WORKERS threads at lowered priority
+ * @param tasks independent tasks, the remaining ones are skipped on a mode switch
+ */
+void DataReduction::RunPool(std::vector<std::function<void()>> & tasks) {
+
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+  size_t n_workers = std::min((size_t)DOWNLINK_N_WORKERS, tasks.size());
+
+  for (size_t i = 0; i < n_workers; i++) {
+    workers.push_back(std::thread([this, &tasks, &next] {
+	  LowerPriority();
+	  size_t j;
+	  while (!SwitchRequested() && (j = next++) < tasks.size()) {
+	    tasks[j]();
+	  }
+	}));
+  }
+  for (auto & worker : workers) {
+    worker.join();
+  }
+
+}
+
+/**
+ * size of the payload of a DOWNLINK_ENTRY
+ * @param level 1 or 2 for a D1 or D2 block, 3 for the STATS_PACKET
+ */
+size_t DataReduction::PayloadSize(uint8_t level) {
+
+  switch (level) {
+  case 1:
+    return sizeof(Z_DATA_TYPE_SCI_L1_V2);
+  case 2:
+    return sizeof(Z_DATA_TYPE_SCI_L2_V2);
+  default:
+    return sizeof(STATS_PACKET);
+  }
+}
+
+/**
+ * list the CPU_RUN_QL files written since the last DOWNLINK file
+ * @param dirs the directories of the run files
+ * @param bundle_dir set to the directory of the most recent CPU_RUN_QL file
+ */
+std::vector<std::string> DataReduction::FindQlFiles(const std::vector<std::string> & dirs, std::string & bundle_dir) {
+
+  std::vector<std::pair<time_t, std::string>> ql_files;
+  time_t last_bundle = 0;
+  struct stat st;
+
+  for (auto & dir : dirs) {
+    DIR * dp = opendir(dir.c_str());
+    if (dp == NULL) {
+      continue;
+    }
+    struct dirent * entry;
+    while ((entry = readdir(dp)) != NULL) {
+      std::string name(entry->d_name);
+      std::string path = dir + "/" + name;
+      if (stat(path.c_str(), &st) != 0) {
+	continue;
+      }
+      if (name.compare(0, 10, "DOWNLINK__") == 0) {
+	last_bundle = std::max(last_bundle, st.st_mtime);
+      }
+      else if (name.compare(0, 12, "CPU_RUN_QL__") == 0
+	       && name.length() > 4 && name.compare(name.length() - 4, 4, ".dat") == 0) {
+	ql_files.push_back(std::make_pair(st.st_mtime, path));
+      }
+    }
+    closedir(dp);
+  }
+
+  std::sort(ql_files.begin(), ql_files.end());
+  std::vector<std::string> new_files;
+  for (auto & ql_file : ql_files) {
+    if (ql_file.first > last_bundle) {
+      new_files.push_back(ql_file.second);
+    }
+  }
+  if (!new_files.empty()) {
+    bundle_dir = new_files.back().substr(0, new_files.back().rfind('/'));
+  }
+
+  return new_files;
+}
+
+/**
+ * read the FLAGS_PACKETs of a CPU_RUN_QL file into candidates for the downlink
+ * @param ql_file_name the CPU_RUN_QL file
+ * @param candidates a candidate is added for each D1 and D2 block
+ */
+int DataReduction::ReadQlFile(std::string ql_file_name, std::vector<Candidate> & candidates) {
+
+  FILE * ql_file = fopen(ql_file_name.c_str(), "rb");
+  if (ql_file == NULL) {
+    clog << "error: " << logstream::error << "cannot open the file " << ql_file_name << std::endl;
+    return 1;
+  }
+
+  /* the flags were added in QL_FILE_VER 2 */
+  CpuFileHeader file_header;
+  if (fread(&file_header, sizeof(file_header), 1, ql_file) != 1
+      || ((file_header.header >> 8) & 0xFF) != QL_FILE_TYPE || (file_header.header & 0xFF) < 2) {
+    clog << "info: " << logstream::info << "no flags in " << ql_file_name << std::endl;
+    fclose(ql_file);
+    return 1;
+  }
+
+  std::string main_file_name = ql_file_name;
+  main_file_name.replace(main_file_name.rfind("CPU_RUN_QL"), 10, "CPU_RUN_MAIN");
+
+  STATS_PACKET * stats_packet = new STATS_PACKET();
+  FLAGS_PACKET flags_packet;
+  while (true) {
+    long stats_offset = ftell(ql_file);
+    if (fread(stats_packet, sizeof(STATS_PACKET), 1, ql_file) != 1
+	|| ((stats_packet->stats_packet_header.header >> 8) & 0xFF) != STATS_PACKET_TYPE
+	|| fread(&flags_packet, sizeof(FLAGS_PACKET), 1, ql_file) != 1
+	|| ((flags_packet.flags_packet_header.header >> 8) & 0xFF) != FLAGS_PACKET_TYPE) {
+      /* trailer or truncated file */
+      break;
+    }
+
+    for (int i = 0; i < flags_packet.N1 && i < MAX_PACKETS_L1; i++) {
+      candidates.push_back({ql_file_name, main_file_name, flags_packet.flags_packet_header.pkt_num,
+	    stats_offset, 0, 1, (uint8_t)i, flags_packet.l1_flags[i].score});
+    }
+    for (int i = 0; i < flags_packet.N2 && i < MAX_PACKETS_L2; i++) {
+      candidates.push_back({ql_file_name, main_file_name, flags_packet.flags_packet_header.pkt_num,
+	    stats_offset, 0, 2, (uint8_t)i, flags_packet.l2_flags[i].score});
+    }
+  }
+  delete stats_packet;
+  fclose(ql_file);
+
+  return 0;
+}
+
+/**
+ * find the position of the Zynq data of each CPU_PACKET in a CPU_RUN_MAIN file
+ * @param main_file_name the CPU_RUN_MAIN file
+ * @param offsets filled with the position of the first D1 block for each pkt_num
+ */
+int DataReduction::IndexMainFile(std::string main_file_name, std::map<uint32_t, ZynqOffset> & offsets) {
+
+  FILE * main_file = fopen(main_file_name.c_str(), "rb");
+  if (main_file == NULL) {
+    clog << "error: " << logstream::error << "cannot open the file " << main_file_name << std::endl;
+    return 1;
+  }
+
+  CpuPktHeader pkt_header;
+  long offset = sizeof(CpuFileHeader);
+  int ret = 0;
+  while (fseek(main_file, offset, SEEK_SET) == 0
+	 && fread(&pkt_header, sizeof(pkt_header), 1, main_file) == 1) {
+
+    if (pkt_header.spacer != ID_TAG) {
+      ret = 1;
+      break;
+    }
+
+    char pkt_type = (pkt_header.header >> 8) & 0xFF;
+    if (pkt_type == CPU_PACKET_TYPE) {
+      ZynqOffset zynq_offset;
+      offset += sizeof(CpuPktHeader) + sizeof(CpuTimeStamp) + sizeof(HK_PACKET);
+      if (fseek(main_file, offset, SEEK_SET) != 0
+	  || fread(&zynq_offset.N1, 1, 1, main_file) != 1 || fread(&zynq_offset.N2, 1, 1, main_file) != 1) {
+	ret = 1;
+	break;
+      }
+      zynq_offset.level1_offset = offset + 2;
+      offsets[pkt_header.pkt_num] = zynq_offset;
+      offset = zynq_offset.level1_offset + zynq_offset.N1 * sizeof(Z_DATA_TYPE_SCI_L1_V2)
+	+ zynq_offset.N2 * sizeof(Z_DATA_TYPE_SCI_L2_V2) + sizeof(Z_DATA_TYPE_SCI_L3_V2);
+    }
+    else if (pkt_type == THERM_PACKET_TYPE) {
+      offset += sizeof(THERM_PACKET);
+    }
+    else if (pkt_type == HV_PACKET_TYPE) {
+      uint32_t n_hvps_log = 0;
+      if (fseek(main_file, sizeof(CpuTimeStamp), SEEK_CUR) != 0
+	  || fread(&n_hvps_log, sizeof(n_hvps_log), 1, main_file) != 1) {
+	ret = 1;
+	break;
+      }
+      offset += sizeof(CpuPktHeader) + sizeof(CpuTimeStamp) + sizeof(uint32_t) + sizeof(ZynqBoardHeader)
+	+ n_hvps_log * sizeof(DATA_TYPE_HVPS_LOG_V1);
+    }
+    else {
+      /* trailer */
+      break;
+    }
+  }
+  if (ret != 0) {
+    clog << "error: " << logstream::error << "cannot read the packet at " << offset << " in " << main_file_name << std::endl;
+  }
+  fclose(main_file);
+
+  return ret;
+}
+
+/**
+ * select the D1 and D2 blocks of the last night with the highest score which fit
+ * in DOWNLINK_BUDGET, at most DOWNLINK_TOP_K of them, and write them to a DOWNLINK file
+ * the STATS_PACKET of each CPU_PACKET a block comes from is also added, as a summary of the D3 data
+ */
+int DataReduction::SelectDownlink() {
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  /* the directories of this instance are only known from the configuration */
+  if (this->ConfigOut == nullptr) {
+    clog << "error: " << logstream::error << "no configuration for the downlink selection" << std::endl;
+    return 1;
+  }
+  long budget = this->ConfigOut->downlink_budget;
+  int top_k = this->ConfigOut->downlink_top_k;
+  std::vector<std::string> run_dirs = {this->ConfigOut->usb_mountpoint_0, this->ConfigOut->done_dir};
+
+  std::string bundle_dir;
+  std::vector<std::string> ql_file_names = FindQlFiles(run_dirs, bundle_dir);
+  if (ql_file_names.empty()) {
+    clog << "info: " << logstream::info << "no new CPU_RUN_QL files for the downlink" << std::endl;
+    return 1;
+  }
+
+  /* read the flags of all files */
+  std::vector<std::vector<Candidate>> file_candidates(ql_file_names.size());
+  std::vector<std::function<void()>> tasks;
+  for (size_t i = 0; i < ql_file_names.size(); i++) {
+    tasks.push_back([&ql_file_names, &file_candidates, i] {
+	ReadQlFile(ql_file_names[i], file_candidates[i]);
+      });
+  }
+  RunPool(tasks);
+
+  std::vector<Candidate> candidates;
+  for (auto & c : file_candidates) {
+    candidates.insert(candidates.end(), c.begin(), c.end());
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+		   [](const Candidate & a, const Candidate & b) { return a.score > b.score; });
+
+  /* greedy selection, the first block of a CPU_PACKET also brings its STATS_PACKET */
+  std::vector<Candidate> selected;
+  std::set<std::pair<std::string, uint32_t>> packets;
+  long total_size = 0;
+  int n_blocks = 0;
+  for (auto & candidate : candidates) {
+    if (n_blocks >= top_k) {
+      break;
+    }
+    auto packet = std::make_pair(candidate.ql_file_name, candidate.pkt_num);
+    bool new_packet = (packets.count(packet) == 0);
+    long size = sizeof(DOWNLINK_ENTRY) + PayloadSize(candidate.level);
+    if (new_packet) {
+      size += sizeof(DOWNLINK_ENTRY) + PayloadSize(3);
+    }
+    if (total_size + size > budget) {
+      continue;
+    }
+    if (new_packet) {
+      Candidate summary = candidate;
+      summary.level = 3;
+      summary.block = 0;
+      selected.push_back(summary);
+      packets.insert(packet);
+    }
+    selected.push_back(candidate);
+    total_size += size;
+    n_blocks++;
+  }
+  if (selected.empty()) {
+    clog << "info: " << logstream::info << "no blocks selected for the downlink" << std::endl;
+    return 1;
+  }
+
+  /* find the selected blocks in the main files */
+  std::map<std::string, std::map<uint32_t, ZynqOffset>> main_offsets;
+  for (auto & item : selected) {
+    main_offsets[item.main_file_name];
+  }
+  tasks.clear();
+  for (auto & main_file : main_offsets) {
+    std::string main_file_name = main_file.first;
+    std::map<uint32_t, ZynqOffset> * offsets = &main_file.second;
+    tasks.push_back([main_file_name, offsets] {
+	IndexMainFile(main_file_name, * offsets);
+      });
+  }
+  RunPool(tasks);
+
+  if (SwitchRequested()) {
+    clog << "info: " << logstream::info << "data reduction stopped by a mode switch" << std::endl;
+    return 1;
+  }
+
+  std::vector<Candidate> found;
+  for (auto & item : selected) {
+    if (item.level == 3) {
+      item.data_offset = item.stats_offset;
+      found.push_back(item);
+      continue;
+    }
+    auto & offsets = main_offsets[item.main_file_name];
+    auto zynq_offset = offsets.find(item.pkt_num);
+    if (zynq_offset == offsets.end()
+	|| (item.level == 1 && item.block >= zynq_offset->second.N1)
+	|| (item.level == 2 && item.block >= zynq_offset->second.N2)) {
+      clog << "error: " << logstream::error << "packet " << item.pkt_num << " not found in " << item.main_file_name << std::endl;
+      continue;
+    }
+    item.data_offset = zynq_offset->second.level1_offset;
+    if (item.level == 1) {
+      item.data_offset += item.block * sizeof(Z_DATA_TYPE_SCI_L1_V2);
+    }
+    else {
+      item.data_offset += zynq_offset->second.N1 * sizeof(Z_DATA_TYPE_SCI_L1_V2)
+	+ item.block * sizeof(Z_DATA_TYPE_SCI_L2_V2);
+    }
+    found.push_back(item);
+  }
+
+  int ret = WriteBundle(found, bundle_dir);
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start_time);
+  clog << "info: " << logstream::info << "downlink selection of " << n_blocks << " blocks from "
+       << candidates.size() << " in " << ql_file_names.size() << " files took " << elapsed.count() << " s" << std::endl;
+
+  return ret;
+}
+
+/**
+ * write the selected blocks to a compressed DOWNLINK file, with a text index
+ * @param selected the blocks and STATS_PACKETs, with their position in the CPU_RUN files
+ * @param bundle_dir directory of the DOWNLINK file
+ */
+int DataReduction::WriteBundle(std::vector<Candidate> & selected, std::string bundle_dir) {
+
+  struct timeval tv;
+  char time_str[MAX_FILENAME_LENGTH];
+  gettimeofday(&tv, 0);
+  time_t now = tv.tv_sec;
+  strftime(time_str, sizeof(time_str), "/DOWNLINK__%Y_%m_%d__%H_%M_%S", localtime(&now));
+  std::string bundle_name = bundle_dir + time_str + ".dat";
+  std::string index_name = bundle_dir + time_str + ".idx";
+
+  clog << "info: " << logstream::info << "writing " << selected.size() << " entries to " << bundle_name << std::endl;
+
+  std::shared_ptr<SynchronisedFile> BundleFile = std::make_shared<SynchronisedFile>(bundle_name);
+  Access * BundleAccess = new Access(BundleFile);
+  std::ofstream index(index_name);
+  index << "# offset size level pkt_num block score run_file" << std::endl;
+
+  CpuFileHeader * bundle_file_header = new CpuFileHeader();
+  bundle_file_header->header = CpuTools::BuildCpuHeader(DOWNLINK_FILE_TYPE, DOWNLINK_FILE_VER);
+  std::string run_info_string = "Downlink selection of the D1 and D2 blocks with the highest score\n";
+  strncpy(bundle_file_header->run_info, run_info_string.c_str(), RUN_INFO_SIZE - 1);
+  bundle_file_header->run_size = selected.size();
+  BundleAccess->WriteToSynchFile<CpuFileHeader *>(bundle_file_header, SynchronisedFile::CONSTANT);
+  delete bundle_file_header;
+
+  Z_DATA_TYPE_SCI_L1_V2 * l1 = new Z_DATA_TYPE_SCI_L1_V2();
+  Z_DATA_TYPE_SCI_L2_V2 * l2 = new Z_DATA_TYPE_SCI_L2_V2();
+  STATS_PACKET * stats_packet = new STATS_PACKET();
+  std::map<std::string, FILE *> run_files;
+  long offset = sizeof(CpuFileHeader);
+  uint32_t n_entries = 0;
+
+  for (auto & item : selected) {
+
+    /* read the payload */
+    std::string & run_file_name = (item.level == 3) ? item.ql_file_name : item.main_file_name;
+    if (run_files.count(run_file_name) == 0) {
+      run_files[run_file_name] = fopen(run_file_name.c_str(), "rb");
+    }
+    FILE * run_file = run_files[run_file_name];
+    void * payload = (item.level == 1) ? (void *)l1 : ((item.level == 2) ? (void *)l2 : (void *)stats_packet);
+    if (run_file == NULL || fseek(run_file, item.data_offset, SEEK_SET) != 0
+	|| fread(payload, PayloadSize(item.level), 1, run_file) != 1) {
+      clog << "error: " << logstream::error << "cannot read packet " << item.pkt_num << " from " << run_file_name << std::endl;
+      continue;
+    }
+
+    DOWNLINK_ENTRY * entry = new DOWNLINK_ENTRY();
+    entry->entry_header.header = CpuTools::BuildCpuHeader(DOWNLINK_ENTRY_TYPE, DOWNLINK_ENTRY_VER);
+    entry->entry_header.pkt_size = sizeof(DOWNLINK_ENTRY) + PayloadSize(item.level);
+    entry->entry_header.pkt_num = n_entries;
+    std::string run_file_base = item.main_file_name.substr(item.main_file_name.rfind('/') + 1);
+    strncpy(entry->run_file, run_file_base.c_str(), DOWNLINK_RUN_FILE_SIZE - 1);
+    entry->run_pkt_num = item.pkt_num;
+    entry->level = item.level;
+    entry->block = item.block;
+    entry->score = (item.level == 3) ? 0 : item.score;
+    BundleAccess->WriteToSynchFile<DOWNLINK_ENTRY *>(entry, SynchronisedFile::CONSTANT);
+
+    switch (item.level) {
+    case 1:
+      BundleAccess->WriteToSynchFile<Z_DATA_TYPE_SCI_L1_V2 *>(l1, SynchronisedFile::CONSTANT);
+      break;
+    case 2:
+      BundleAccess->WriteToSynchFile<Z_DATA_TYPE_SCI_L2_V2 *>(l2, SynchronisedFile::CONSTANT);
+      break;
+    default:
+      BundleAccess->WriteToSynchFile<STATS_PACKET *>(stats_packet, SynchronisedFile::CONSTANT);
+      break;
+    }
+
+    index << offset << " " << entry->entry_header.pkt_size << " " << (int)entry->level << " "
+	  << entry->run_pkt_num << " " << (int)entry->block << " " << entry->score << " "
+	  << entry->run_file << std::endl;
+    offset += entry->entry_header.pkt_size;
+    n_entries++;
+    delete entry;
+  }
+
+  for (auto & run_file : run_files) {
+    if (run_file.second != NULL) {
+      fclose(run_file.second);
+    }
+  }
+  delete l1;
+  delete l2;
+  delete stats_packet;
+
+  CpuFileTrailer * bundle_file_trailer = new CpuFileTrailer();
+  bundle_file_trailer->header = CpuTools::BuildCpuHeader(TRAILER_PACKET_TYPE, DOWNLINK_FILE_VER);
+  bundle_file_trailer->run_size = n_entries;
+  bundle_file_trailer->crc = BundleAccess->GetChecksum();
+  BundleAccess->WriteToSynchFile<CpuFileTrailer *>(bundle_file_trailer, SynchronisedFile::CONSTANT);
+  delete bundle_file_trailer;
+  BundleAccess->CloseSynchFile();
+  delete BundleAccess;
+  index.close();
+
+  /* compress, gzip inherits the lowered priority of this thread */
+  std::string cmd = "gzip -f " + bundle_name;
+  int ret = system(cmd.c_str());
+  if (ret == -1 || !WIFEXITED(ret) || WEXITSTATUS(ret) != 0) {
+    clog << "error: " << logstream::error << "cannot compress " << bundle_name
+	 << ", gzip status " << ret << std::endl;
+    return 1;
+  }
+  clog << "info: " << logstream::info << "downlink file " << bundle_name << ".gz with " << n_entries << " entries" << std::endl;
+
+  return 0;
+}
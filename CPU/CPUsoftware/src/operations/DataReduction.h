@@ -3,34 +3,89 @@
 
 #include <thread>
 #include <unistd.h>
+#include <vector>
+#include <map>
+#include <set>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#ifndef __APPLE__
+#include <sys/syscall.h>
+#endif /* __APPLE__ */
 
 #include "log.h"
 #include "OperationMode.h"
 #include "AnalogManager.h"
 #include "ThermManager.h"
 #include "ConfigManager.h"
+#include "DataAcquisition.h"
 
 
 /* for use with conditional variable */
 #define WAIT_PERIOD 1 /* milliseconds */
 
+/* number of threads reading the files of the night */
+#define DOWNLINK_N_WORKERS 2
+/* niceness of the data reduction threads */
+#define DOWNLINK_NICE 19
+
 
 /**
  * DAY operational mode: data reduction 
  * class to handle data reduction and preparation of diagnostic samples 
- * to be sent to Earth and check the instrument is operating correctly
- * @TODO add main functionality
+ * to be sent to Earth and check the instrument is operating correctly.
+ * the D1 and D2 blocks of the last night are ranked by their score in the
+ * CPU_RUN_QL files, and the best ones which fit in DOWNLINK_BUDGET are
+ * packed with the D3 summary of their packet into a compressed DOWNLINK file
  */
 class DataReduction : public OperationMode {
 public:
   
   DataReduction();
   void Start();
+  int SelectDownlink();
 
 
 private:
 
+  /**
+   * a D1 or D2 block, or a D3 summary, which can be sent
+   */
+  struct Candidate {
+    std::string ql_file_name;
+    std::string main_file_name;
+    uint32_t pkt_num;
+    long stats_offset; /* of the STATS_PACKET in the CPU_RUN_QL file */
+    long data_offset; /* of the payload in its file, set for selected candidates */
+    uint8_t level;
+    uint8_t block;
+    float score;
+  };
+  /**
+   * position of the Zynq data of a CPU_PACKET in a CPU_RUN_MAIN file
+   */
+  struct ZynqOffset {
+    long level1_offset;
+    uint8_t N1;
+    uint8_t N2;
+  };
+
   int RunDataReduction();
+  bool SwitchRequested();
+  void RunPool(std::vector<std::function<void()>> & tasks);
+  static void LowerPriority();
+  static std::vector<std::string> FindQlFiles(const std::vector<std::string> & dirs, std::string & bundle_dir);
+  static int ReadQlFile(std::string ql_file_name, std::vector<Candidate> & candidates);
+  static int IndexMainFile(std::string main_file_name, std::map<uint32_t, ZynqOffset> & offsets);
+  static size_t PayloadSize(uint8_t level);
+  int WriteBundle(std::vector<Candidate> & selected, std::string bundle_dir);
   
 };
 
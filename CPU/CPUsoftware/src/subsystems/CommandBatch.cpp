@@ -0,0 +1,70 @@
+#include "CommandBatch.h"
+
+/**
+ * constructor
+ */
+CommandBatch::CommandBatch() {
+
+  this->n_collapsed = 0;
+}
+
+/**
+ * add a command to the batch
+ * a slow control selection is only added if it changes the selection
+ * @param cmd the command, with or without new line
+ */
+void CommandBatch::Add(std::string cmd) {
+
+  cmd.erase(std::remove(cmd.begin(), cmd.end(), '\n'), cmd.end());
+
+  /* "slowctrl <key> <value>" for a selection */
+  std::stringstream ss(cmd);
+  std::string stem, key, value, extra;
+  ss >> stem >> key >> value;
+  if (stem + " " == SLOWCTRL_SELECT_PREFIX && !value.empty() && !(ss >> extra)) {
+    for (const std::string select_key : SLOWCTRL_SELECT_KEYS) {
+      if (key == select_key) {
+	auto current = this->_selection.find(key);
+	if (current != this->_selection.end() && current->second == value) {
+	  this->n_collapsed++;
+	  return;
+	}
+	this->_selection[key] = value;
+	break;
+      }
+    }
+  }
+
+  this->commands.push_back(cmd);
+}
+
+/**
+ * empty the batch, the selections are then unknown
+ */
+void CommandBatch::Clear() {
+
+  this->commands.clear();
+  this->replies.clear();
+  this->_selection.clear();
+  this->n_collapsed = 0;
+}
+
+/**
+ * number of commands in the batch
+ */
+size_t CommandBatch::Size() {
+
+  return this->commands.size();
+}
+
+/**
+ * true if a reply shows that its command failed
+ * @param reply the reply to the command, empty if none was received
+ */
+bool CommandBatch::Failed(const std::string & reply) {
+
+  std::string lower = reply;
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+  return (reply.empty() || lower.find("error") != std::string::npos);
+}
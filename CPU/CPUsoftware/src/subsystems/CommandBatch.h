@@ -0,0 +1,49 @@
+#ifndef _COMMAND_BATCH_H
+#define _COMMAND_BATCH_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <algorithm>
+
+/* commands which select the target of the following slow control commands */
+#define SLOWCTRL_SELECT_PREFIX "slowctrl "
+#define SLOWCTRL_SELECT_KEYS {"line", "asic", "pixel"}
+
+/**
+ * list of telnet commands to be sent to the Zynq in one go, with
+ * their replies. the slow control selections (line, asic and pixel)
+ * which do not change the current selection are not added, so that
+ * consecutive pixels of the same ASIC only need the pixel selection
+ */
+class CommandBatch {
+public:
+  /**
+   * commands to send, without new line
+   */
+  std::vector<std::string> commands;
+  /**
+   * reply to each command, empty if none was received
+   */
+  std::vector<std::string> replies;
+  /**
+   * number of selections which were not added
+   */
+  int n_collapsed;
+
+  CommandBatch();
+  void Add(std::string cmd);
+  void Clear();
+  size_t Size();
+  static bool Failed(const std::string & reply);
+
+private:
+  /**
+   * current value of each slow control selection in the batch
+   */
+  std::map<std::string, std::string> _selection;
+};
+
+#endif
+/* _COMMAND_BATCH_H */
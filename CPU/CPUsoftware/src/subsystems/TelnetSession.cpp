@@ -0,0 +1,390 @@
+#include "TelnetSession.h"
+
+/**
+ * constructor
+ * the connection is only opened on first use
+ * @param ip address of the telnet server
+ * @param port of the telnet server
+ * @param timeout_sec timeout of the connection in s
+ * @param terminator end of a reply, a line by default, or the prompt of the server
+ */
+TelnetSession::TelnetSession(std::string ip, int port, int timeout_sec, std::string terminator) {
+
+  this->_ip = ip;
+  this->_port = port;
+  this->_timeout_sec = timeout_sec;
+  this->_sockfd = -1;
+  this->_terminator = terminator;
+  this->_n_pending = 0;
+  this->n_connect = 0;
+}
+
+/**
+ * destructor
+ */
+TelnetSession::~TelnetSession() {
+
+  Close();
+}
+
+/**
+ * socket of the session, opened again if the connection was lost
+ * returns the socket file descriptor, or -1 if the server cannot be reached
+ */
+int TelnetSession::Socket() {
+
+  /* with no reply expected, what is left from earlier replies is stale */
+  if (this->_n_pending == 0 && !this->_rx.empty()) {
+    clog << "info: " << logstream::info << "discarded " << this->_rx.size() << " bytes left over from an earlier reply" << std::endl;
+    this->_rx.clear();
+  }
+
+  if (Alive()) {
+    return this->_sockfd;
+  }
+
+  if (this->_sockfd >= 0) {
+    clog << "info: " << logstream::info << "telnet connection to " << this->_ip << " lost, reconnecting" << std::endl;
+    Close();
+  }
+  Open();
+
+  return this->_sockfd;
+}
+
+/**
+ * open the connection, with a timeout
+ * returns 0 on success
+ */
+int TelnetSession::Open() {
+
+  struct sockaddr_in serv_addr;
+  struct timeval tv;
+  fd_set fdset;
+
+  Close();
+
+  /* numeric addresses do not need a name lookup */
+  bzero((char *) &serv_addr, sizeof(serv_addr));
+  serv_addr.sin_family = AF_INET;
+  serv_addr.sin_port = htons(this->_port);
+  if (inet_pton(AF_INET, this->_ip.c_str(), &serv_addr.sin_addr) != 1) {
+    struct hostent * server = gethostbyname(this->_ip.c_str());
+    if (server == NULL) {
+      clog << "error: " << logstream::error << "no host found for " << this->_ip << std::endl;
+      return 1;
+    }
+    bcopy((char *)server->h_addr, (char *)&serv_addr.sin_addr.s_addr, server->h_length);
+  }
+
+  int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  if (sockfd < 0) {
+    clog << "error: " << logstream::error << "error opening socket" << std::endl;
+    return 1;
+  }
+
+  /* non-blocking connect with a timeout */
+  int opts = fcntl(sockfd, F_GETFL);
+  fcntl(sockfd, F_SETFL, opts | O_NONBLOCK);
+  connect(sockfd, (struct sockaddr *) &serv_addr, sizeof(serv_addr));
+
+  FD_ZERO(&fdset);
+  FD_SET(sockfd, &fdset);
+  tv.tv_sec = this->_timeout_sec;
+  tv.tv_usec = 0;
+
+  int so_error = -1;
+  if (select(sockfd + 1, NULL, &fdset, NULL, &tv) == 1) {
+    socklen_t len = sizeof so_error;
+    getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+  }
+  if (so_error != 0) {
+    clog << "error: " << logstream::error << "error connecting to " << this->_ip << " on port " << this->_port << std::endl;
+    close(sockfd);
+    return 1;
+  }
+  fcntl(sockfd, F_SETFL, opts & (~O_NONBLOCK));
+
+  /* keepalive, and commands are sent straight away */
+  int on = 1;
+  setsockopt(sockfd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+  setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#ifdef TCP_KEEPIDLE
+  int keepidle = TELNET_KEEPIDLE_SEC;
+  int keepintvl = TELNET_KEEPINTVL_SEC;
+  int keepcnt = TELNET_KEEPCNT;
+  setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPIDLE, &keepidle, sizeof(keepidle));
+  setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPINTVL, &keepintvl, sizeof(keepintvl));
+  setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPCNT, &keepcnt, sizeof(keepcnt));
+#endif /* TCP_KEEPIDLE */
+#ifdef SO_NOSIGPIPE
+  setsockopt(sockfd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif /* SO_NOSIGPIPE */
+
+  this->_sockfd = sockfd;
+  this->n_connect++;
+  clog << "info: " << logstream::info << "connected to " << this->_ip << " on port " << this->_port
+       << " (connection " << this->n_connect << ")" << std::endl;
+
+  return 0;
+}
+
+/**
+ * close the connection, it is opened again on next use
+ */
+void TelnetSession::Close() {
+
+  if (this->_sockfd >= 0) {
+    close(this->_sockfd);
+    this->_sockfd = -1;
+  }
+  this->_rx.clear();
+  this->_n_pending = 0;
+}
+
+/**
+ * change the server of the session, the connection is opened to it on next use
+ * @param ip address of the telnet server
+ * @param port of the telnet server
+ */
+void TelnetSession::SetServer(std::string ip, int port) {
+
+  Close();
+  this->_ip = ip;
+  this->_port = port;
+}
+
+/**
+ * true if the connection is open, it may have been lost since
+ */
+bool TelnetSession::IsOpen() {
+
+  return (this->_sockfd >= 0);
+}
+
+/**
+ * wait for the server to close the connection, such as on a reboot
+ * what is received in the meantime is discarded
+ * @param timeout_ms maximum time to wait
+ * returns true if the connection was closed within the timeout
+ */
+bool TelnetSession::WaitClosed(int timeout_ms) {
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (this->_sockfd >= 0) {
+
+    int time_left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    struct pollfd pfd;
+    pfd.fd = this->_sockfd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int ready = (time_left > 0) ? poll(&pfd, 1, time_left) : 0;
+    if (ready < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ready <= 0) {
+      return false;
+    }
+
+    char buffer[256];
+    if ((pfd.revents & (POLLERR | POLLHUP | POLLNVAL))
+	|| recv(this->_sockfd, buffer, sizeof(buffer), 0) <= 0) {
+      Close();
+    }
+  }
+
+  return true;
+}
+
+/**
+ * check that the connection has not been closed or reset by the server
+ * if no reply is expected, bytes received since the last reply are discarded
+ */
+bool TelnetSession::Alive() {
+
+  if (this->_sockfd < 0) {
+    return false;
+  }
+
+  struct pollfd pfd;
+  pfd.fd = this->_sockfd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  if (poll(&pfd, 1, 0) < 0) {
+    return false;
+  }
+  if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+    return false;
+  }
+
+  /* readable with no command sent: a late reply, or the end of the connection */
+  if ((pfd.revents & POLLIN) && this->_n_pending == 0) {
+    char buffer[256];
+    int n_stale = 0;
+    ssize_t n;
+    while ((n = recv(this->_sockfd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+      n_stale += n;
+    }
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+      return false;
+    }
+    clog << "info: " << logstream::info << "discarded " << n_stale << " bytes from the telnet connection" << std::endl;
+  }
+
+  return true;
+}
+
+/**
+ * send a command and read its reply
+ * @param cmd the command, a new line is added if missing
+ * @param reply the reply, without new lines, empty on error
+ * @param timeout_ms timeout of the reply
+ * returns 0 on success
+ */
+int TelnetSession::Command(const std::string & cmd, std::string & reply, int timeout_ms) {
+
+  reply.clear();
+  if (Send(cmd) != 0) {
+    return 1;
+  }
+
+  return Receive(reply, timeout_ms);
+}
+
+/**
+ * send a command without waiting for its reply, which is read with Receive()
+ * commands can be sent before the replies to the previous ones are read
+ * @param cmd the command, a new line is added if missing
+ * returns 0 on success
+ */
+int TelnetSession::Send(const std::string & cmd) {
+
+  /* the connection is only checked when no reply is expected, as the check discards what is received */
+  if (this->_n_pending == 0) {
+    if (Socket() < 0) {
+      return 1;
+    }
+  }
+  else if (this->_sockfd < 0) {
+    return 1;
+  }
+
+  std::string msg = cmd;
+  if (msg.empty() || msg.back() != '\n') {
+    msg += '\n';
+  }
+  std::string log_msg = msg;
+  log_msg.erase(std::remove(log_msg.begin(), log_msg.end(), '\n'), log_msg.end());
+  clog << "info: " << logstream::info << "sending via telnet: " << log_msg << std::endl;
+
+  size_t sent = 0;
+  while (sent < msg.size()) {
+    ssize_t n = send(this->_sockfd, msg.data() + sent, msg.size() - sent, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      clog << "error: " << logstream::error << "error writing to socket" << std::endl;
+      Close();
+      return 1;
+    }
+    sent += n;
+  }
+  this->_n_pending++;
+
+  return 0;
+}
+
+/**
+ * read the next reply, as soon as its terminator is received
+ * @param reply the reply, without new lines, empty on error
+ * @param timeout_ms timeout of the reply
+ * returns 0 on success
+ */
+int TelnetSession::Receive(std::string & reply, int timeout_ms) {
+
+  reply.clear();
+  if (this->_sockfd < 0) {
+    return 1;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (true) {
+
+    /* a complete reply, which may be an empty line */
+    size_t end = this->_rx.find(this->_terminator);
+    if (end != std::string::npos) {
+      reply = this->_rx.substr(0, end);
+      this->_rx.erase(0, end + this->_terminator.size());
+      reply.erase(std::remove(reply.begin(), reply.end(), '\r'), reply.end());
+      reply.erase(std::remove(reply.begin(), reply.end(), '\n'), reply.end());
+      clog << "info: " << logstream::info << "receiving via telnet: " << reply << std::endl;
+      this->_n_pending = std::max(this->_n_pending - 1, 0);
+      return 0;
+    }
+
+    /* wait for more */
+    int time_left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    struct pollfd pfd;
+    pfd.fd = this->_sockfd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int ready = (time_left > 0) ? poll(&pfd, 1, time_left) : 0;
+    if (ready < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ready <= 0) {
+      clog << "error: " << logstream::error << "no reply via telnet after " << timeout_ms << " ms" << std::endl;
+      Close();
+      return 1;
+    }
+
+    char buffer[256];
+    ssize_t n = recv(this->_sockfd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+      clog << "error: " << logstream::error << "error reading from socket" << std::endl;
+      Close();
+      return 1;
+    }
+    this->_rx.append(buffer, n);
+  }
+}
+
+/**
+ * send many commands, with up to max_in_flight commands sent ahead of their replies
+ * the commands are sent and answered in order, so that the round trips overlap.
+ * on a failure the connection is closed and the remaining replies are left empty
+ * @param cmds the commands
+ * @param replies the reply to each command, empty if none was received
+ * @param max_in_flight maximum number of commands waiting for their reply
+ * @param timeout_ms timeout of each reply
+ * returns the number of commands without a reply
+ */
+int TelnetSession::Pipeline(const std::vector<std::string> & cmds, std::vector<std::string> & replies,
+			    int max_in_flight, int timeout_ms) {
+
+  replies.assign(cmds.size(), "");
+  if (max_in_flight < 1) {
+    max_in_flight = 1;
+  }
+
+  size_t n_sent = 0;
+  size_t n_received = 0;
+  while (n_received < cmds.size()) {
+
+    /* keep the pipe full */
+    while (n_sent < cmds.size() && n_sent - n_received < (size_t)max_in_flight) {
+      if (Send(cmds[n_sent]) != 0) {
+	return cmds.size() - n_received;
+      }
+      n_sent++;
+    }
+
+    if (Receive(replies[n_received], timeout_ms) != 0) {
+      return cmds.size() - n_received;
+    }
+    n_received++;
+  }
+
+  return 0;
+}
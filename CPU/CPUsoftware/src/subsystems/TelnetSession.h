@@ -0,0 +1,94 @@
+#ifndef _TELNET_SESSION_H
+#define _TELNET_SESSION_H
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "log.h"
+
+/* TCP keepalive of the session: idle time and interval in s, number of probes */
+#define TELNET_KEEPIDLE_SEC 10
+#define TELNET_KEEPINTVL_SEC 5
+#define TELNET_KEEPCNT 3
+
+/* default timeout of a reply in ms */
+#define TELNET_TIMEOUT_MS 2000
+/* end of a reply of the Zynq, replies are one line */
+#define TELNET_TERMINATOR "\n"
+/* default number of commands sent ahead of their replies by Pipeline() */
+#define TELNET_MAX_IN_FLIGHT 16
+
+/* not defined on all platforms */
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif /* MSG_NOSIGNAL */
+
+
+/**
+ * long-lived telnet connection to the Zynq board.
+ * the connection is opened on first use and kept open, with TCP keepalive
+ * so that a dead peer is noticed. each use checks that the connection is
+ * still alive, and it is opened again if not, for example after a reboot.
+ * a reply is framed by the terminator, or the prompt, of the server, and
+ * is read as soon as it is complete, with a timeout for each command.
+ * an empty line is an empty reply. commands are answered in order, and
+ * after a timeout the connection is closed so that a late reply cannot be
+ * taken for that of the next command. lines left over from earlier replies
+ * are discarded before a command is sent with no reply pending
+ */
+class TelnetSession {
+public:
+  /**
+   * number of connections opened since construction
+   */
+  uint32_t n_connect;
+
+  TelnetSession(std::string ip, int port, int timeout_sec, std::string terminator = TELNET_TERMINATOR);
+  ~TelnetSession();
+  int Socket();
+  int Open();
+  void Close();
+  void SetServer(std::string ip, int port);
+  bool IsOpen();
+  bool WaitClosed(int timeout_ms);
+  int Command(const std::string & cmd, std::string & reply, int timeout_ms = TELNET_TIMEOUT_MS);
+  int Send(const std::string & cmd);
+  int Receive(std::string & reply, int timeout_ms = TELNET_TIMEOUT_MS);
+  int Pipeline(const std::vector<std::string> & cmds, std::vector<std::string> & replies,
+	       int max_in_flight = TELNET_MAX_IN_FLIGHT, int timeout_ms = TELNET_TIMEOUT_MS);
+
+private:
+  std::string _ip;
+  int _port;
+  int _timeout_sec;
+  int _sockfd;
+  std::string _terminator;
+  /**
+   * bytes received after the end of the last reply
+   */
+  std::string _rx;
+  /**
+   * number of commands sent whose reply has not been read
+   */
+  int _n_pending;
+
+  bool Alive();
+};
+
+#endif
+/* _TELNET_SESSION_H */
@@ -8,6 +8,8 @@ UsbManager::UsbManager() {
   this->num_storage_dev = N_USB_UNDEF;
   this->backup_launched = false;  
   this->storage_bus = STORAGE_BUS_NEW;
+  this->mountpoint_0 = USB_MOUNTPOINT_0;
+  this->mountpoint_1 = USB_MOUNTPOINT_1;
 }
 
 /**
@@ -240,8 +242,8 @@ int UsbManager::DataBackup() {
   std::string cmd;
   std::string log_path(LOG_DIR);
   //std::string inotify_log = "/inotify.log";
-  std::string mp_0(USB_MOUNTPOINT_0);
-  std::string mp_1(USB_MOUNTPOINT_1);
+  std::string mp_0(this->mountpoint_0);
+  std::string mp_1(this->mountpoint_1);
 
   clog << "info: " << logstream::info << "defining data backup procedure" << std::endl;
   this->num_storage_dev = LookupUsbStorage();
@@ -254,8 +256,8 @@ int UsbManager::DataBackup() {
     /* run backup */
     std::cout << "running data backup in the background" << std::endl;
 
-    /* synchronise /media/usb0 to /media/usb1 */
-    cmd = "while true; do rsync -avzr /media/usb0/* /media/usb1; done 2>&1";
+    /* synchronise mountpoint_0 to mountpoint_1 */
+    cmd = "while true; do rsync -avzr " + mp_0 + "/* " + mp_1 + "; done 2>&1";
 
     /*
     alternative command which works on creation/modification/deletion
@@ -7,13 +7,11 @@
 
 #include "log.h"
 #include "CpuTools.h"
+#include "ConfigManager.h"
 
 #define MIN_DEVICE_NUM 5 /* number of devices without extra storage or config USBs */
 #define NOMINAL_DEVICE_NUM 9 /* number of devices expected */
 
-#define USB_MOUNTPOINT_0 "/media/usb0"
-#define USB_MOUNTPOINT_1 "/media/usb1"
-
 #define N_USB_UNDEF 0xFF
 
 /* configuration for spare CPU in Stockholm */
@@ -44,6 +42,11 @@ public:
    * stores true if a data backup is running
    */
   bool backup_launched;
+  /**
+   * mountpoints of the storage devices, USB_MOUNTPOINT_0 and USB_MOUNTPOINT_1 by default
+   */
+  std::string mountpoint_0;
+  std::string mountpoint_1;
   
   UsbManager();
   static int CheckUsb();
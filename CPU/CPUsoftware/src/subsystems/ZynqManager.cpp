@@ -4,8 +4,12 @@
  * constructor 
  * initialises public members
  * hvps_status, instrument_mode, test_mode and telnet_connected
+ * @param ip address of the Zynq
+ * @param port telnet port of the Zynq
  */
-ZynqManager::ZynqManager () {   
+ZynqManager::ZynqManager (std::string ip, int port) : _session(ip, port, SHORT_TIMEOUT_SEC) {   
+  this->_ip = ip;
+  this->_port = port;
   this->hvps_status = ZynqManager::UNDEF;
   this->zynq_mode = ZynqManager::NONE;
   this->test_mode = ZynqManager::T_NONE;
@@ -14,27 +18,104 @@ ZynqManager::ZynqManager () {
   /* initialise vector of EC values to 0 */
   for (int i = 0; i < N_EC; i++) {
     this->ec_values.push_back(0);
+    this->dv_values.push_back(0);
+  }
+  this->auto_mask_file = AUTO_MASK_FILE;
+
+  /* nothing is known of the slow control until it is loaded */
+  this->_loaded.n_connect = 0;
+  ForgetSlowCtrl();
+
+  this->boot_to_ready_ms = -1;
+  this->_rebooting = false;
+  this->_dv_set = false;
+
+  /* the I/O thread owns the telnet session */
+  this->n_coalesced = 0;
+  this->_stop_io = false;
+  this->_io_thread = std::thread(&ZynqManager::IoLoop, this);
+}
+
+/**
+ * destructor
+ * the commands in the queue are run before the I/O thread stops
+ */
+ZynqManager::~ZynqManager() {
+
+  {
+    std::unique_lock<std::mutex> lock(this->_m_queue);
+    this->_stop_io = true;
+  }
+  this->_cv_queue.notify_one();
+  if (this->_io_thread.joinable()) {
+    this->_io_thread.join();
+  }
+}
+
+/**
+ * run the queued commands one at a time, the lowest lane first
+ */
+void ZynqManager::IoLoop() {
+
+  while (true) {
+
+    QueuedCommand next;
+    {
+      std::unique_lock<std::mutex> lock(this->_m_queue);
+      this->_cv_queue.wait(lock, [this] {
+	  return this->_stop_io || !this->_queue[LANE_URGENT].empty()
+	    || !this->_queue[LANE_CONTROL].empty() || !this->_queue[LANE_STATUS].empty(); });
+
+      int lane = 0;
+      while (lane < N_LANES && this->_queue[lane].empty()) {
+	lane++;
+      }
+      if (lane == N_LANES) {
+	return;
+      }
+      next = this->_queue[lane].front();
+      this->_queue[lane].pop_front();
+    }
+
+    next.run();
   }
 }
 
+/**
+ * true if called from the I/O thread
+ */
+bool ZynqManager::OnIoThread() {
+
+  return (std::this_thread::get_id() == this->_io_thread.get_id());
+}
+
+/**
+ * true if an HV off, queued with the key ZYNQ_HV_OFF_KEY, is waiting,
+ * so that the HV ramp can give way to it
+ */
+bool ZynqManager::HvOffPending() {
+
+  std::unique_lock<std::mutex> lock(this->_m_queue);
+  for (const QueuedCommand & queued : this->_queue[LANE_URGENT]) {
+    if (queued.key == ZYNQ_HV_OFF_KEY) {
+      return true;
+    }
+  }
+  return false;
+}
+
 
 /**
  * check if the telnet socekt is responding as expected
+ * the status is always read again, as a cached reply says nothing of the connection
  */
 bool ZynqManager::CheckTelnet() {
 
   bool connected = false;
-  int sockfd;
   std::string status_string = "";
   
-  /* set up the telnet connection */
-  sockfd = ConnectTelnet();
-
   std::cout << "..." << std::endl;
-  if (sockfd > 0) {
-    status_string = SendRecvTelnet("instrument status\n", sockfd);
-    close(sockfd);
-  }
+  status_string = ReadInstStatus(true);
 
   size_t found = status_string.find("40");
   if (found != std::string::npos) {
@@ -45,37 +126,72 @@ bool ZynqManager::CheckTelnet() {
 }
 
 /**
- * check telnet connection on ZYNQ_IP (defined in ZynqManager.h)
- * and close the telnet connection after.
- * has a timeout implemented of length CONNECT_TIMEOUT_SEC (defined in ZynqManager.h)
+ * one attempt to reach the Zynq, on the I/O thread: a TCP connection and,
+ * once it is accepted, the instrument status
+ * @param n_probes number of attempts so far, for the log
+ * returns true if the Zynq answered
+ */
+bool ZynqManager::ProbeReady(int n_probes) {
+
+  if (this->_session.Socket() < 0 || !CheckTelnet()) {
+    return false;
+  }
+
+  if (this->_rebooting) {
+    auto now = std::chrono::steady_clock::now();
+    this->boot_to_ready_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - this->_reboot_time).count();
+    this->_rebooting = false;
+    clog << "info: " << logstream::info << "Zynq ready " << this->boot_to_ready_ms << " ms after the reboot ("
+	 << n_probes << " attempts)" << std::endl;
+  }
+
+  return true;
+}
+
+/**
+ * check telnet connection to the Zynq, ZYNQ_IP (defined in ZynqManager.h) unless set by SetEndpoint()
+ * waits for the Zynq to be ready, such as after a boot: TCP connections are
+ * tried with a backoff from PROBE_MIN_MS to PROBE_MAX_MS, and once one is
+ * accepted the instrument status is asked for once.
+ * has a timeout implemented of length CONNECT_TIMEOUT_SEC (defined in ZynqManager.h).
+ * waits on the calling thread, and each attempt is queued for the I/O thread,
+ * so that other commands, such as the HV off, can run in between
  */
 int ZynqManager::CheckConnect() {
- 
-  clog << "info: " << logstream::info << "checking connection to IP " << ZYNQ_IP  << std::endl;
 
-  /* initilaise timeout timer */
-  time_t start = time(0);
-  int time_left = CONNECT_TIMEOUT_SEC;
-  
-  /* wait for answer on telnet */
-  while (!CheckTelnet() && time_left > 0) {
-    
-    sleep(2);
+  std::string ip = GetIp();
+  int port;
+  {
+    std::unique_lock<std::mutex> lock(this->_m_state);
+    port = this->_port;
+  }
+  clog << "info: " << logstream::info << "checking connection to IP " << ip << std::endl;
 
-    /* timeout if no activity after CONNECT_TIMEOUT_SEC reached */
-    time_t end = time(0);
-    time_t time_taken = end - start;
-    time_left = CONNECT_TIMEOUT_SEC - time_taken;
+  auto start_time = std::chrono::steady_clock::now();
+  auto deadline = start_time + std::chrono::seconds(CONNECT_TIMEOUT_SEC);
+  int backoff_ms = PROBE_MIN_MS;
+  int n_probes = 0;
   
-  }
-  /* catch connection timeout */
-  if (!CheckTelnet()) {
+  /* wait for a connection, then for an answer on telnet */
+  while (true) {
+
+    n_probes++;
+    if (Run<bool>([this, n_probes]() { return ProbeReady(n_probes); })) {
+      break;
+    }
+
+    /* timeout if no answer after CONNECT_TIMEOUT_SEC reached */
+    if (std::chrono::steady_clock::now() + std::chrono::milliseconds(backoff_ms) > deadline) {
 
-    std::cout << "ERROR: Connection timeout to the Zynq board" << std::endl;
-    clog << "error: " << logstream::error << "error connecting to " << ZYNQ_IP << " on port " << TELNET_PORT << std::endl;
+      std::cout << "ERROR: Connection timeout to the Zynq board" << std::endl;
+      clog << "error: " << logstream::error << "error connecting to " << ip << " on port " << port
+	   << " after " << n_probes << " attempts" << std::endl;
     
-    this->telnet_connected = false;
-    return 1;
+      this->telnet_connected = false;
+      return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+    backoff_ms = std::min(2 * backoff_ms, PROBE_MAX_MS);
   }
 
   this->telnet_connected = true;
@@ -83,201 +199,182 @@ int ZynqManager::CheckConnect() {
 }
 
 /**
- * send and recieve commands over the telnet connection
- * to be used inside a function which opens the telnet connection 
- * @param send_msg the message to be sent
- * @param sockfd the socket field descriptor
+ * talk to the Zynq at another address, such as that of the configuration file
+ * the state read from the previous Zynq is forgotten
+ * @param ip address of the Zynq
+ * @param port telnet port of the Zynq
  */
-std::string ZynqManager::SendRecvTelnet(std::string send_msg, int sockfd) {
+int ZynqManager::SetEndpoint(std::string ip, int port) {
 
-  const char * kSendMsg = send_msg.c_str();
-  char buffer[256];
-  std::string recv_msg;
-  std::string err_msg = "error";
-  int n;
-  
-  /* prepare the message to send */
-  bzero(buffer, 256);
-  strncpy(buffer, kSendMsg, sizeof(buffer));
-  send_msg.erase(std::remove(send_msg.begin(), send_msg.end(), '\n'), send_msg.end());
-  clog << "info: " << logstream::info << "sending via telnet: " << send_msg << std::endl;
- 
-  n = write(sockfd, buffer, strlen(buffer));
-  if (n < 0) {
-    clog << "error: " << logstream::error << "error writing to socket" << std::endl;
-    return err_msg;
+  if (!OnIoThread()) {
+    return Run<int>([=]() { return SetEndpoint(ip, port); });
   }
-  bzero(buffer, 256);
-  n = read(sockfd, buffer, 255);
-  if (n < 0) {
-    clog << "error: " << logstream::error << "error reading from socket" << std::endl;
-    return err_msg;
+
+  {
+    std::unique_lock<std::mutex> lock(this->_m_state);
+    if (ip == this->_ip && port == this->_port) {
+      return 0;
+    }
+    this->_ip = ip;
+    this->_port = port;
   }
-  recv_msg = buffer;
-  recv_msg.erase(std::remove(recv_msg.begin(), recv_msg.end(), '\r'), recv_msg.end());
-  recv_msg.erase(std::remove(recv_msg.begin(), recv_msg.end(), '\n'), recv_msg.end());
-  clog << "info: " << logstream::info << "receiving via telnet: " << recv_msg << std::endl;
-  return recv_msg;
- }
+  clog << "info: " << logstream::info << "Zynq set to " << ip << " on port " << port << std::endl;
+
+  this->_session.SetServer(ip, port);
+  ForgetState(true);
+  this->telnet_connected = false;
+
+  return 0;
+}
 
 /**
- * send a command over the telnet connection
- * does not wait for a reply, to be used with "reboot" command
- * to be used inside a function which opens the telnet connection 
- * @param send_msg the message to be sent
- * @param sockfd the socket field descriptor
+ * address of the Zynq
  */
-int ZynqManager::SendTelnet(std::string send_msg, int sockfd) {
+std::string ZynqManager::GetIp() {
 
-  const char * kSendMsg = send_msg.c_str();
-  char buffer[256];
-  int n;
-  
-  /* prepare the message to send */
-  bzero(buffer, 256);
-  strncpy(buffer, kSendMsg, sizeof(buffer));
-  send_msg.erase(std::remove(send_msg.begin(), send_msg.end(), '\n'), send_msg.end());
-  clog << "info: " << logstream::info << "sending via telnet: " << send_msg << std::endl;
- 
-  n = write(sockfd, buffer, strlen(buffer));
-  if (n < 0) {
-    clog << "error: " << logstream::error << "error writing to socket" << std::endl;
-    return -1;
+  std::unique_lock<std::mutex> lock(this->_m_state);
+  return this->_ip;
+}
+
+/**
+ * check the connection, then the instrument and HV status
+ * from another thread, the connection is waited for with CheckConnect(), then
+ * the status is queued in LANE_STATUS with the key ZYNQ_STATUS_KEY, so that
+ * the status queries of different threads are answered by a single one
+ * returns 0 if connected
+ */
+int ZynqManager::UpdateStatus() {
+
+  if (!OnIoThread()) {
+    CheckConnect();
+    return Run<int>([this]() { return UpdateStatus(); }, LANE_STATUS, ZYNQ_STATUS_KEY);
   }
 
+  if (!this->telnet_connected) {
+    return 1;
+  }
+  GetInstStatus();
+  GetHvpsStatus();
+
+  /* for the run files */
+  GetZynqVer();
+
   return 0;
 }
 
 
 /**
- * wrapper for use of SendRecvTelnet() in more readable way
+ * send a command over the telnet connection and read its reply
+ * the reply is read as soon as it is complete
  * @param send_msg message to send
- * @param sockfd the socket file descriptor
  * @param print if true, received message is printed
- * returns the recieved telnet response
+ * @param timeout_ms timeout of the reply
+ * returns the recieved telnet response, empty on error
  */
-std::string ZynqManager::Telnet(const std::string & send_msg, int sockfd, bool print) {
+std::string ZynqManager::Telnet(const std::string & send_msg, bool print, int timeout_ms) {
+
+  /* only the I/O thread uses the session */
+  if (!OnIoThread()) {
+    return Run<std::string>([=]() { return Telnet(send_msg, print, timeout_ms); });
+  }
 
   std::string status_string = "";
   
-  if (sockfd > 0) {
-    status_string = SendRecvTelnet(send_msg, sockfd);
-    if (print) {
-      std::cout << status_string << std::endl;
-    }
-    usleep(SLEEP_TIME);
+  if (this->_session.Command(send_msg, status_string, timeout_ms) != 0) {
+    clog << "error: " << logstream::error << "no reply from the Zynq to: " << send_msg << std::endl;
+    ForgetState(false);
   }
-  else {
-    clog << "error: " << logstream::error << "bad socket passed to ZynqManager::Telnet()" << std::endl;
+  else if (print) {
+    std::cout << status_string << std::endl;
   }
   return status_string;
 }
 
 /**
- * wrapper for use of SendTelnet() in more readable way
+ * send a command over the telnet connection
+ * does not wait for a reply, to be used with "reboot" command
  * @param send_msg message to send
- * @param sockfd the socket file descriptor
  * returns 0 if successful
  */
-int ZynqManager::TelnetSendOnly(std::string send_msg, int sockfd) {
+int ZynqManager::TelnetSendOnly(const std::string & send_msg) {
 
-  int status = 0;
-  
-  if (sockfd > 0) {
-    status = SendTelnet(send_msg, sockfd);
-    usleep(SLEEP_TIME);
-  }
-  else {
-    clog << "error: " << logstream::error << "bad socket passed to ZynqManager::Telnet()" << std::endl;
+  if (!OnIoThread()) {
+    return Run<int>([=]() { return TelnetSendOnly(send_msg); });
   }
-  return status;
-}
 
+  return this->_session.Send(send_msg);
+}
 
 /**
- * connect via telnet to ZYNQ_IP.
- * NB: leaves telnet open to be closed with a separate function 
+ * send a batch of commands, pipelined on the telnet connection, and check every reply
+ * a command fails if it has no reply or if its reply is an error
+ * @param batch the commands, the replies are stored in it
+ * returns the number of failed commands
  */
-int ZynqManager::ConnectTelnet() {
+int ZynqManager::RunBatch(CommandBatch & batch) {
 
-  /* definitions */
-  int sockfd;
-  struct sockaddr_in serv_addr;
-  struct hostent * server;
-  const char * ip = ZYNQ_IP;
-  struct timeval tv;
-  fd_set fdset;
-  
-  clog << "info: " << logstream::info << "checking connection to IP " << ZYNQ_IP  << std::endl;
-
-  /* debug */
-  clog << "info: " << logstream::info << "setting up telnet connection" << std::endl;  
-   
-  /* set up the telnet connection */
-  sockfd = socket(AF_INET, SOCK_STREAM, 0);
-  if (sockfd < 0) { 
-    clog << "error: " << logstream::error << "error opening socket" << std::endl;
-    return 1;
+  if (!OnIoThread()) {
+    return Run<int>([&]() { return RunBatch(batch); });
   }
 
-  /* debug */
-  clog << "info: " << logstream::info << "retrieving server" << std::endl;  
-   
-  server = gethostbyname(ip);
-  if (server == NULL) {
-    clog << "error: " << logstream::error << "no host found for " << ZYNQ_IP << std::endl;  
-    return 1;
+  if (batch.Size() == 0) {
+    return 0;
   }
-  
-  /* debug */
-  clog << "info: " << logstream::info << "setting server address" << std::endl;  
 
-  bzero((char *) &serv_addr, sizeof(serv_addr));
-  serv_addr.sin_family = AF_INET;
-  bcopy((char *)server->h_addr, 
-	(char *)&serv_addr.sin_addr.s_addr,
-	server->h_length);
-  serv_addr.sin_port = htons(TELNET_PORT);
+  auto start_time = std::chrono::steady_clock::now();
+  this->_session.Pipeline(batch.commands, batch.replies);
 
-  /* debug */
-  clog << "info: " << logstream::info << "set port to non-blocking" << std::endl;  
+  int n_failed = 0;
+  for (size_t i = 0; i < batch.Size(); i++) {
+    if (CommandBatch::Failed(batch.replies[i])) {
+      n_failed++;
+      clog << "error: " << logstream::error << "command " << i << " of batch failed: " << batch.commands[i]
+	   << " (reply: " << batch.replies[i] << ")" << std::endl;
+    }
+  }
 
-  /* set non-blocking */
-  int opts = fcntl(sockfd, F_SETFL, O_NONBLOCK);
-  connect(sockfd, (struct sockaddr *) &serv_addr, sizeof(serv_addr));
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+  clog << "info: " << logstream::info << "batch of " << batch.Size() << " commands (" << batch.n_collapsed
+       << " selections skipped) took " << elapsed.count() << " ms, " << n_failed << " failed" << std::endl;
 
-  FD_ZERO(&fdset);
-  FD_SET(sockfd, &fdset);
+  return n_failed;
+}
 
-  /* add timeout */
-  tv.tv_sec = SHORT_TIMEOUT_SEC; 
-  tv.tv_usec = 0;
+/**
+ * forget the slow control state loaded on the Zynq, so that it is sent in full next time
+ * to be used when the Zynq is rebooted or power cycled
+ */
+void ZynqManager::ForgetSlowCtrl() {
+
+  this->_loaded.dac10.assign(N_PMT, SLOWCTRL_UNKNOWN);
+  this->_loaded.mask.reset();
+  this->_loaded.mask_known = false;
+  this->_loaded.n1 = SLOWCTRL_UNKNOWN;
+  this->_loaded.n2 = SLOWCTRL_UNKNOWN;
+  this->_loaded.n_bg = SLOWCTRL_UNKNOWN;
+  this->_loaded.low_thresh = SLOWCTRL_UNKNOWN;
+  this->_loaded.test_mode = SLOWCTRL_UNKNOWN;
+}
 
-  /* debug */
-  clog << "info: " << logstream::info << "connect to socket" << std::endl;  
-  
-  if (select(sockfd + 1, NULL, &fdset, NULL, &tv) == 1) {
-      int so_error;
-      socklen_t len = sizeof so_error;
-      
-      getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &so_error, &len);
-      
-      if (so_error == 0) {
-	clog << "info: " << logstream::info << "connected to " << ZYNQ_IP << " on port " << TELNET_PORT  << std::endl;
+/**
+ * check that the slow control state is still that of the Zynq
+ * if the telnet connection was opened again the Zynq may have rebooted, and the state is forgotten
+ */
+void ZynqManager::CheckSlowCtrl() {
 
-	/* clear non-blocking */
-	opts = opts & (~O_NONBLOCK);
-	fcntl(sockfd, F_SETFL, opts);   
-      }
-      else {
+  if (!OnIoThread()) {
+    Run<int>([this]() { CheckSlowCtrl(); return 0; });
+    return;
+  }
 
-	clog << "error: " << logstream::error << "error connecting to " << ZYNQ_IP << " on port " << TELNET_PORT << std::endl;
-	return -1;
-      }
-      
+  this->_session.Socket();
+  if (this->_session.n_connect != this->_loaded.n_connect) {
+    if (this->_loaded.n_connect != 0) {
+      clog << "info: " << logstream::info << "new connection to the Zynq, sending the full slow control" << std::endl;
     }
-  
-  return sockfd;   
+    ForgetSlowCtrl();
+    this->_loaded.n_connect = this->_session.n_connect;
+  }
 }
 
 /**
@@ -285,17 +382,15 @@ int ZynqManager::ConnectTelnet() {
  */
 int ZynqManager::GetInstStatus() {
 
-  int sockfd;
+  if (!OnIoThread()) {
+    return Run<int>([this]() { return GetInstStatus(); });
+  }
 
   clog << "info: " << logstream::info << "checking the instrument status" << std::endl;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
-
   /* get the instrument status */
-  std::cout << "instrument status: ";
-  std::string status = Telnet("instrument status\n", sockfd, true);
-  close(sockfd);
+  std::string status = ReadInstStatus();
+  std::cout << "instrument status: " << status << std::endl;
 
   /* perform checks */
   size_t found = status.find("40");
@@ -303,10 +398,15 @@ int ZynqManager::GetInstStatus() {
     clog << "error: " << logstream::error << "instrument status is: " << status << std::endl;
   }
 
-  int reported_zynq_mode = stoi(status.substr(3, std::string::npos));
+  try {
+    int reported_zynq_mode = stoi(status.substr(3, std::string::npos));
 
-  if (reported_zynq_mode != this->zynq_mode) {
-    clog << "error: " << logstream::error << "zynq_mode is: " << reported_zynq_mode << std::endl;
+    if (reported_zynq_mode != this->zynq_mode) {
+      clog << "error: " << logstream::error << "zynq_mode is: " << reported_zynq_mode << std::endl;
+    }
+  }
+  catch (const std::logic_error &) {
+    clog << "error: " << logstream::error << "problem reading instrument status" << std::endl;
   }
   
   return 0;
@@ -317,15 +417,13 @@ int ZynqManager::GetInstStatus() {
  */
 int ZynqManager::InstrumentClean() {
 
-  int sockfd;
+  if (!OnIoThread()) {
+    return Run<int>([this]() { return InstrumentClean(); });
+  }
 
   clog << "info: " << logstream::info << "clearing FTP server on Zynq side" << std::endl;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
-
-  std::string status = Telnet("instrument clean\n", sockfd, true);
-  close(sockfd);
+  std::string status = Telnet("instrument clean\n", true, LONG_TIMEOUT_MS);
   
   return 0;
 
@@ -336,15 +434,13 @@ int ZynqManager::InstrumentClean() {
  */
 int ZynqManager::Reboot() {
 
-  int sockfd;
+  if (!OnIoThread()) {
+    return Run<int>([this]() { return Reboot(); });
+  }
 
   clog << "info: " << logstream::info << "Rebooting the Zynq" << std::endl;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
-
-  int status = TelnetSendOnly("reboot\n", sockfd);
-  close(sockfd);
+  int status = TelnetSendOnly("reboot\n");
 
   if (status == 0) {
     clog << "info: " << logstream::info << "Reboot command sent sucessfully" << std::endl;
@@ -352,7 +448,18 @@ int ZynqManager::Reboot() {
   else {
    clog << "error: " << logstream::error << "Reboot command failed to send" << std::endl;
   }
-  
+  this->_reboot_time = std::chrono::steady_clock::now();
+  this->_rebooting = true;
+
+  /* the reboot is under way once the Zynq drops the connection, the slow control is then reset */
+  if (!this->_session.WaitClosed(SHUTDOWN_TIMEOUT_MS)) {
+    clog << "info: " << logstream::info << "Zynq still connected " << SHUTDOWN_TIMEOUT_MS << " ms after the reboot command" << std::endl;
+  }
+  this->_session.Close();
+  ForgetSlowCtrl();
+  ForgetState(true);
+  this->_dv_set = false;
+
   /* Reset the telnet_connected switch */
   this->telnet_connected = false;
   
@@ -360,12 +467,49 @@ int ZynqManager::Reboot() {
 
 }
 
+/**
+ * Reboot the Zynq, and set it up as soon as it is ready
+ * the reboot, each attempt to reach the Zynq and the setup are queued for the
+ * I/O thread one by one, so that urgent commands can run in between.
+ * not to be run on the I/O thread with Run()
+ * @param setup_script_path the USB mountpoint of the setup files, see Setup()
+ * @param hide_pixels if true, the pixels of DeadPixelMask.txt are masked
+ * returns 0 if the Zynq was set up
+ */
+int ZynqManager::Restart(std::string setup_script_path, bool hide_pixels) {
+
+  auto start_time = std::chrono::steady_clock::now();
+  Reboot();
+
+  clog << "info: " << logstream::info << "waiting for boot" << std::endl;
+  std::cout << "waiting for boot..." << std::endl;
+  if (CheckConnect() != 0) {
+    return 1;
+  }
+  std::cout << "Zynq ready " << this->boot_to_ready_ms << " ms after the reboot" << std::endl;
+
+  clog << "info: " << logstream::info << "setting up Zynq with DAC 10 tables and trigger mask" << std::endl; 
+  Setup(setup_script_path);
+  if (hide_pixels) {
+    HidePixels();
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+  clog << "info: " << logstream::info << "Zynq set up " << elapsed.count() << " ms after the reboot" << std::endl;
+
+  return 0;
+}
+
 /**
  * Set the ASIC DAC10 values from a text file provided by the USB.
  * Adapted from C. Giammanco's script to use socket programming instead of netcat.
  */
 int ZynqManager::SetMatrixDac10(const std::string &usb_mountpoint, bool debug) {
 
+  if (!OnIoThread()) {
+    return Run<int>([&]() { return SetMatrixDac10(usb_mountpoint, debug); });
+  }
+
   std::string dac10_filename;
   std::vector<int> dac10_values;
   
@@ -384,46 +528,69 @@ int ZynqManager::SetMatrixDac10(const std::string &usb_mountpoint, bool debug) {
 
     /* read values from file */
     dac10_values = CpuTools::ReadMatrixDac10(dac10_filename);
-    if (dac10_values.size() != N_PMT) {
-      clog << "error: " << logstream::error << "Dac10 matrix has more than " << N_PMT << " values." << std::endl;
-    }
     
   }
 
-  /* connect to telnet */
-  int sockfd = ConnectTelnet();
-  std::string cmd;
-  
-  /* enter command loop */
+  return this->SetMatrixDac10(dac10_values);
+}
+
+/**
+ * Set the ASIC DAC10 values
+ * @param dac10_values N_PMT values in the order of the dac10.txt matrix
+ */
+int ZynqManager::SetMatrixDac10(std::vector<int> dac10_values) {
+
+  if (!OnIoThread()) {
+    return Run<int>([&]() { return SetMatrixDac10(dac10_values); });
+  }
+
+  if (dac10_values.size() != N_PMT) {
+    clog << "error: " << logstream::error << "Dac10 matrix does not have " << N_PMT << " values." << std::endl;
+    return 1;
+  }
+
+  /* only the values which differ from those loaded are sent */
+  CheckSlowCtrl();
+
+  /* one batch, a selection is only sent when it changes */
+  CommandBatch batch;
   int line = 0, pixel = 0, val = 0;
   unsigned int index;
   for (int asic=0; asic<N_ASIC; asic++) {
 
-    cmd = "slowctrl asic " + std::to_string(asic) + "\n";
-    Telnet(cmd, sockfd, true);
-
     for (int board=0; board<N_ASIC; board++) {
 
+      index = (asic * 6) + board;
+      val = dac10_values[index];
+      if (val == this->_loaded.dac10[index]) {
+	continue;
+      }
+      batch.Add("slowctrl asic " + std::to_string(asic));
+
       line = 5 - board;
-      cmd = "slowctrl line " + std::to_string(line) + "\n";
-      Telnet(cmd, sockfd, true);
+      batch.Add("slowctrl line " + std::to_string(line));
       
-      index = (asic * 6) + board;
-      cmd = "slowctrl pixel " + std::to_string(pixel) + "\n";
-      Telnet(cmd, sockfd, true);
+      batch.Add("slowctrl pixel " + std::to_string(pixel));
       
-      val = dac10_values[index];
-      cmd = "slowctrl dac10 " + std::to_string(val) + "\n";
-      Telnet (cmd, sockfd, true);
+      batch.Add("slowctrl dac10 " + std::to_string(val));
       
     }
   }
-  cmd = "slowctrl apply\n";
-  Telnet(cmd, sockfd, true);
+  if (batch.Size() == 0) {
+    clog << "info: " << logstream::info << "Dac10 matrix already loaded" << std::endl;
+    return 0;
+  }
+  batch.Add("slowctrl apply");
 
-  close(sockfd);
- 
-  return 0;
+  int n_failed = RunBatch(batch);
+  if (n_failed == 0) {
+    this->_loaded.dac10 = dac10_values;
+  }
+  else {
+    this->_loaded.dac10.assign(N_PMT, SLOWCTRL_UNKNOWN);
+  }
+
+  return n_failed;
 }
 
 /**
@@ -431,6 +598,10 @@ int ZynqManager::SetMatrixDac10(const std::string &usb_mountpoint, bool debug) {
  */
 int ZynqManager::Setup(std::string setup_script_path) {
 
+  if (!OnIoThread()) {
+    return Run<int>([&]() { return Setup(setup_script_path); });
+  }
+
   std::cout << "Trying to set DAC 10 values to 200...." << std::endl;
   std::cout << "Using new ZynqManager::SetMatrixDac10()!" << std::endl;
 
@@ -445,17 +616,15 @@ int ZynqManager::Setup(std::string setup_script_path) {
  */
 int ZynqManager::GetHvpsStatus() {
 
-  int sockfd;
+  if (!OnIoThread()) {
+    return Run<int>([this]() { return GetHvpsStatus(); });
+  }
 
   clog << "info: " << logstream::info << "checking the HVPS status" << std::endl;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
-
   /* get the HVPS status */
-  std::cout << "HVPS status: ";
-  std::string status = Telnet("hvps status gpio\n", sockfd, true);
-  close(sockfd);
+  std::string status = ReadHvpsStatus();
+  std::cout << "HVPS status: " << status << std::endl;
 
   /* perform checks */
   /* ! disabled this for now as causing problems ! */
@@ -483,19 +652,21 @@ int ZynqManager::GetHvpsStatus() {
  */
 int ZynqManager::HvpsTurnOn(int cv, std::string hvps_dv_string, std::string hvps_ec_string) {
 
-  int sockfd;
+  if (!OnIoThread()) {
+    return Run<int>([&]() { return HvpsTurnOn(cv, hvps_dv_string, hvps_ec_string); });
+  }
+
   std::string cmd;
   
   clog << "info: " << logstream::info << "turning on the HVPS" << std::endl;
+  this->_dv_set = false;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
   
   /* set the cathode voltage */
   /* make the command string from config file values */
   cmd = CpuTools::BuildStr("hvps cathode", " ", cv, N_EC);
   std::cout << "Set HVPS cathode to " << cv << ": "; 
-  Telnet(cmd, sockfd, true);
+  Telnet(cmd, true, LONG_TIMEOUT_MS);
 
   /* find max_dv to ramp to, assume small differences between EC units */
   std::vector<int> dv_values = CpuTools::DelimStrToVec(hvps_dv_string, ',', N_EC, false);
@@ -515,14 +686,14 @@ int ZynqManager::HvpsTurnOn(int cv, std::string hvps_dv_string, std::string hvps
     cmd = CpuTools::BuildStr("hvps setdac", " ", dac, N_EC);
     std::cout << "Set HVPS DAC to " << dac << ": "; 
   }
-  Telnet(cmd, sockfd, true);
+  Telnet(cmd, true, LONG_TIMEOUT_MS);
   
   /* turn on */
   /* make the command string from hvps_ec_string */
   this->ec_values = CpuTools::DelimStrToVec(hvps_ec_string, ',', N_EC, true);
   cmd = CpuTools::BuildStrFromVec("hvps turnon", " ", this->ec_values); 
   std::cout << "Turn on HVPS: ";
-  Telnet(cmd, sockfd, true);
+  Telnet(cmd, true, LONG_TIMEOUT_MS);
   
   /* ramp up in steps of 500 DAC */
   int ramp_dac[8];
@@ -543,10 +714,20 @@ int ZynqManager::HvpsTurnOn(int cv, std::string hvps_dv_string, std::string hvps
   }
   bool ramp_done = false;
   while (!ramp_done && i < 8) {  
+    if (HvOffPending()) {
+      /* the HV off is next, other urgent commands wait for the end of the ramp */
+      clog << "info: " << logstream::info << "HV ramp interrupted at DAC " << ramp_dac[i] << " for the HV off" << std::endl;
+      this->hvps_status = ZynqManager::UNDEF;
+      ForgetState(false);
+      return 1;
+    }
     if (max_dv > ramp_dac[i]) {
       cmd = CpuTools::BuildStr("hvps setdac", " ", ramp_dac[i], N_EC);
       std::cout << "Set HVPS DAC to " << ramp_dac[i] << ": ";
-      Telnet(cmd, sockfd, true);
+      Telnet(cmd, true, LONG_TIMEOUT_MS);
+
+      /* let the HV settle before the next step */
+      std::this_thread::sleep_for(std::chrono::milliseconds(HV_RAMP_STEP_MS));
 
       i += 1;
     }
@@ -556,18 +737,18 @@ int ZynqManager::HvpsTurnOn(int cv, std::string hvps_dv_string, std::string hvps
   }
       
   /* set the final DAC to individual EC unit values */
+  this->dv_values = dv_values;
+  this->_dv_set = true;
   cmd = CpuTools::BuildStrFromVec("hvps setdac", " ", dv_values);
   std::cout << "Set HVPS DAC to " << hvps_dv_string << ": ";
-  Telnet(cmd, sockfd, true);
+  Telnet(cmd, true, LONG_TIMEOUT_MS);
   
   /* check the status */
-  std::cout << "HVPS status: ";
-  Telnet("hvps status gpio\n", sockfd, true);
+  std::cout << "HVPS status: " << ReadHvpsStatus(true) << std::endl;
   
   /* update the HvpsStatus */
   this->hvps_status = ZynqManager::ON;
   
-  close(sockfd);
   return 0;
 }
 
@@ -577,23 +758,21 @@ int ZynqManager::HvpsTurnOn(int cv, std::string hvps_dv_string, std::string hvps
  */
 int ZynqManager::HvpsTurnOff() {
 
-  int sockfd;
+  if (!OnIoThread()) {
+    return Run<int>([this]() { return HvpsTurnOff(); });
+  }
+
   std::string cmd;
 
   clog << "info: " << logstream::info << "turning off the HVPS" << std::endl;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
-
   /* turn off */
   std::cout << "HVPS turn off: ";
   cmd = CpuTools::BuildStr("hvps turnoff", " ", 1, N_EC);
-  Telnet(cmd, sockfd, true);
+  Telnet(cmd, true, LONG_TIMEOUT_MS);
 
   /* check the status */
-  std::cout << "HVPS status: ";
-  Telnet("hvps status gpio\n", sockfd, true);
-  close(sockfd); 
+  std::cout << "HVPS status: " << ReadHvpsStatus(true) << std::endl;
 
   /* update the HvpsStatus */
   this->hvps_status = ZynqManager::OFF;
@@ -608,50 +787,176 @@ int ZynqManager::HvpsTurnOff() {
 
 
 /**
- * take an scurve 
+ * turn off the HV of some EC units only
+ * @param ec_mask vector of N_EC values, 1 <=> turn off, 0 <=> unchanged
+ */
+int ZynqManager::HvpsTurnOffEc(std::vector<int> ec_mask) {
+
+  if (!OnIoThread()) {
+    return Run<int>([&]() { return HvpsTurnOffEc(ec_mask); });
+  }
+
+  std::string cmd;
+
+  if (ec_mask.size() != N_EC) {
+    clog << "error: " << logstream::error << "wrong number of EC units to turn off" << std::endl;
+    return 1;
+  }
+  
+  clog << "info: " << logstream::info << "turning off the HVPS of EC units "
+       << CpuTools::BuildStrFromVec("", " ", ec_mask) << std::endl;
+
+  /* turn off */
+  std::cout << "HVPS turn off: ";
+  cmd = CpuTools::BuildStrFromVec("hvps turnoff", " ", ec_mask);
+  Telnet(cmd, true, LONG_TIMEOUT_MS);
+
+  /* check the status */
+  std::cout << "HVPS status: " << ReadHvpsStatus(true) << std::endl;
+
+  /* update the ec_values */
+  for (uint8_t i = 0; i < ec_values.size(); i++) {
+    if (ec_mask[i]) {
+      this->ec_values[i] = 0;
+    }
+  }
+  
+  return 0;
+}
+
+
+/**
+ * lower the dynode voltage, and so the gain, of some EC units
+ * "hvps setdac" takes the DAC of all EC units, so the others are sent the
+ * values set by HvpsTurnOn(), and nothing is done unless its ramp was
+ * completed in this process
+ * @param ec_mask vector of N_EC values, 1 <=> lower, 0 <=> unchanged
+ * @param dac_step HV DAC to subtract from the dynode voltage set by HvpsTurnOn()
+ */
+int ZynqManager::HvpsLowerDac(std::vector<int> ec_mask, int dac_step) {
+
+  if (!OnIoThread()) {
+    return Run<int>([&]() { return HvpsLowerDac(ec_mask, dac_step); });
+  }
+
+  std::string cmd;
+
+  if (ec_mask.size() != N_EC) {
+    clog << "error: " << logstream::error << "wrong number of EC units to lower" << std::endl;
+    return 1;
+  }
+  if (this->hvps_status != ZynqManager::ON) {
+    clog << "info: " << logstream::info << "HVPS not turned on, dynode voltage not lowered" << std::endl;
+    return 1;
+  }
+  if (!this->_dv_set) {
+    clog << "error: " << logstream::error << "dynode voltage of the EC units not known, as the HV was not ramped up by this program, not lowered" << std::endl;
+    return 1;
+  }
+
+  /* the EC units out of the mask keep their DAC */
+  std::vector<int> new_dv = this->dv_values;
+  for (uint8_t i = 0; i < new_dv.size(); i++) {
+    if (ec_mask[i]) {
+      new_dv[i] = std::max(new_dv[i] - dac_step, 0);
+    }
+  }
+  
+  clog << "info: " << logstream::info << "lowering the HVPS DAC to "
+       << CpuTools::BuildStrFromVec("", " ", new_dv) << std::endl;
+
+  cmd = CpuTools::BuildStrFromVec("hvps setdac", " ", new_dv);
+  std::cout << "Set HVPS DAC: ";
+  std::string reply = Telnet(cmd, true, LONG_TIMEOUT_MS);
+  if (CommandBatch::Failed(reply)) {
+    /* the DAC on the Zynq is not known any more */
+    clog << "error: " << logstream::error << "HVPS DAC not lowered (reply: " << reply << ")" << std::endl;
+    this->_dv_set = false;
+    return 1;
+  }
+  this->dv_values = new_dv;
+
+  return 0;
+}
+
+
+/**
+ * take an scurve, and return on its completion, for a readout without inotify
+ * the scan cannot complete before all its GTUs are taken, and its status is
+ * only asked for from then on, every SCURVE_POLL_MS.
+ * not to be run on the I/O thread with Run(), so that other commands,
+ * such as the HV off, are not held up by the scan
  */
 int ZynqManager::Scurve(int start, int step, int stop, int acc) {
   
-  int sockfd;
+  auto start_time = std::chrono::steady_clock::now();
+  StartScurve(start, step, stop, acc);
+
+  auto min_duration = ScurveDuration(start, step, stop, acc);
+  std::this_thread::sleep_until(start_time + min_duration);
+
+  while(!this->CheckScurve()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(SCURVE_POLL_MS));
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+  clog << "info: " << logstream::info << "S-curve took " << elapsed.count() << " ms, at least "
+       << min_duration.count() << " ms expected" << std::endl;
+  
+  return 0;
+}
+
+/**
+ * start an scurve, and return without waiting for its completion
+ */
+int ZynqManager::StartScurve(int start, int step, int stop, int acc) {
+
   std::string cmd;
   std::stringstream conv;
   std::string status_string;
   
   clog << "info: " << logstream::info << "taking an S-curve" << std::endl;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
-  
   /* take an s-curve */
   std::cout << "S-Curve acquisition starting" << std::endl;
   conv << "acq scurve " << start << " " << step << " " << stop << " " << acc << std::endl;
   cmd = conv.str();
   std::cout << cmd;
   
-  status_string = SendRecvTelnet(cmd, sockfd);
+  status_string = Telnet(cmd, false);
+  ForgetState(false);
 
-  while(!this->CheckScurve(sockfd)) {
-    sleep(1);
-  }
-  
-  close(sockfd);
   return 0;
 }
 
+/**
+ * shortest possible duration of an scurve, the GTUs of all its thresholds
+ */
+std::chrono::milliseconds ZynqManager::ScurveDuration(int start, int step, int stop, int acc) {
+
+  int n_thresholds = (step > 0 && stop >= start) ? (stop - start) / step + 1 : 1;
+
+  return std::chrono::milliseconds((int64_t)n_thresholds * acc * SCURVE_GTU_NS / 1000000);
+}
+
 
 /**
  * check the S-curve acquisition status and return true on completion
  */
-bool ZynqManager::CheckScurve(int sockfd) {
+bool ZynqManager::CheckScurve() {
+
+  if (!OnIoThread()) {
+    return Run<bool>([this]() { return CheckScurve(); });
+  }
 
   bool scurve_status = false;
   std::string status_string;
   
-  status_string = SendRecvTelnet("acq scurve status\n", sockfd);
-  std::cout << "acq scurve status: " << status_string << std::endl;
+  status_string = Telnet("acq scurve status\n", false);
 
   size_t noacq_found = status_string.find("GatheringInProgress=0");
   if (noacq_found != std::string::npos) {
+    std::cout << "acq scurve status: " << status_string << std::endl;
 
     clog << "info: " << logstream::info << "update ZynqManager::CheckScurve(), Scurve completed!" << std::endl;
     
@@ -672,25 +977,25 @@ bool ZynqManager::CheckScurve(int sockfd) {
  */
 int ZynqManager::SetDac(int dac_level) {
 
+  if (!OnIoThread()) {
+    return Run<int>([&]() { return SetDac(dac_level); });
+  }
+
   /* definitions */
   std::string status_string;
-  int sockfd;
   std::string cmd;
   std::stringstream conv;
 
   clog << "info: " << logstream::info << "set the dac level to the SPACIROCs" << std::endl;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
   
   /* set the dac level */
   conv << "slowctrl all dac " << dac_level << std::endl;
   cmd = conv.str();
   std::cout << cmd;
   
-  Telnet(cmd, sockfd, false);
+  Telnet(cmd, false);
 
-  close(sockfd);
   return 0;
 }
 
@@ -700,25 +1005,25 @@ int ZynqManager::SetDac(int dac_level) {
  */
 int ZynqManager::AcqShot() {
 
+  if (!OnIoThread()) {
+    return Run<int>([this]() { return AcqShot(); });
+  }
+
   /* definitions */
   std::string status_string;
-  int sockfd;
   std::string cmd;
   std::stringstream conv;
 
   clog << "info: " << logstream::info << "acquiring a single frame from the SPACIROCs" << std::endl;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
   
   /* take a single frame */
   conv << "acq shot" << std::endl;
   cmd = conv.str();
   std::cout << cmd;
 
-  Telnet(cmd, sockfd, false);
+  Telnet(cmd, false);
 
-  close(sockfd);
   return 0;
 }
 
@@ -728,9 +1033,12 @@ int ZynqManager::AcqShot() {
  */
 uint8_t ZynqManager::SetZynqMode() {
 
+  if (!OnIoThread()) {
+    return Run<uint8_t>([this]() { return SetZynqMode(); });
+  }
+
   /* definitions */
   std::string status_string;
-  int sockfd;
   std::string cmd;
   std::stringstream conv;
 
@@ -738,17 +1046,14 @@ uint8_t ZynqManager::SetZynqMode() {
 
   clog << "info: " << logstream::info << "ZynqManager switching to zynq mode " << (int)input_mode << std::endl;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
-
   /* define the command to send via telnet */
   uint32_t timestamp = time(NULL);
   conv << "instrument mode " << (int)this->zynq_mode << " " << timestamp << std::endl;
   cmd = conv.str();
-  Telnet(cmd, sockfd, false);  
+  Telnet(cmd, false);  
 
-  /* check the status */
-  std::string status = Telnet("instrument status\n", sockfd, false);
+  /* check the status, which has changed */
+  std::string status = ReadInstStatus(true);
 
   try {
     int reported_zynq_mode = std::stoi(status.substr(2,5));
@@ -761,11 +1066,10 @@ uint8_t ZynqManager::SetZynqMode() {
 	   << std::endl;
     }
   }
-  catch (std::invalid_argument) {
+  catch (const std::logic_error &) {
     std::cout << "ERROR: problem reading instrument status" << std::endl;
   }
 
-  close(sockfd); 
   return this->zynq_mode;
 }
 
@@ -776,9 +1080,12 @@ uint8_t ZynqManager::SetZynqMode() {
  */
 ZynqManager::TestMode ZynqManager::SetTestMode() {
 
+  if (!OnIoThread()) {
+    return Run<TestMode>([this]() { return SetTestMode(); });
+  }
+
   /* definitions */
   std::string status_string;
-  int sockfd;
   std::string cmd;
   std::stringstream conv;
 
@@ -786,36 +1093,40 @@ ZynqManager::TestMode ZynqManager::SetTestMode() {
   
   clog << "info: " << logstream::info << "switching to zynq test mode " << input_mode << std::endl;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
+  /* only sent if it differs from the loaded test mode */
+  CheckSlowCtrl();
+  if ((int)this->test_mode == this->_loaded.test_mode) {
+    return this->test_mode;
+  }
 
   /* define the command to send over telnet */
   conv << "acq test " << (int)this->test_mode << std::endl;
   cmd = conv.str();
   
-  Telnet(cmd, sockfd, false);
+  status_string = Telnet(cmd, false);
+  this->_loaded.test_mode = status_string.empty() ? SLOWCTRL_UNKNOWN : (int)this->test_mode;
   
-  close(sockfd);
   return this->test_mode;
 }
 
 
 /**
- * static function to stop acquisition by setting the instrument to NONE 
+ * stop acquisition by setting the instrument to NONE 
  */
 int ZynqManager::StopAcquisition() {
 
+  if (!OnIoThread()) {
+    return Run<int>([this]() { return StopAcquisition(); });
+  }
+
   /* definitions */
   std::string status_string;
-  int sockfd;
 
   clog << "info: " << logstream::info << "switching off the Zynq acquisition" << std::endl;
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
-  Telnet("instrument mode 0\n", sockfd, false);
+  Telnet("instrument mode 0\n", false);
+  ForgetState(false);
   
-  close(sockfd);
   return 0;
 }
 
@@ -827,27 +1138,27 @@ int ZynqManager::StopAcquisition() {
  */
 int ZynqManager::SetNPkts(int N1, int N2) {
 
-  /* definitions */
-  std::string status_string;
-  int sockfd;
-  std::string cmd1, cmd2;
-  std::stringstream conv1, conv2;
+  if (!OnIoThread()) {
+    return Run<int>([&]() { return SetNPkts(N1, N2); });
+  }
 
   clog << "info: " << logstream::info << "setting N1 to " << N1 << " and N2 to " << N2 << std::endl;
 
-  /* create the command */
-  conv1 << "mmg N1 " << N1 << std::endl;
-  cmd1 = conv1.str();
-  conv2 << "mmg N2 " << N2 << std::endl;
-  cmd2 = conv2.str();
+  /* only the values which differ from those loaded are sent */
+  CheckSlowCtrl();
+  CommandBatch batch;
+  if (N1 != this->_loaded.n1) {
+    batch.Add("mmg N1 " + std::to_string(N1));
+  }
+  if (N2 != this->_loaded.n2) {
+    batch.Add("mmg N2 " + std::to_string(N2));
+  }
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
-  Telnet(cmd1, sockfd, false);
-  Telnet(cmd2, sockfd, false);
+  int n_failed = RunBatch(batch);
+  this->_loaded.n1 = (n_failed == 0) ? N1 : SLOWCTRL_UNKNOWN;
+  this->_loaded.n2 = (n_failed == 0) ? N2 : SLOWCTRL_UNKNOWN;
  
-  close(sockfd);
-  return 0;
+  return n_failed;
 }
 
 
@@ -858,79 +1169,160 @@ int ZynqManager::SetNPkts(int N1, int N2) {
  */
 int ZynqManager::SetL2TrigParams(int n_bg, int low_thresh) {
 
-  /* definitions */
-  std::string status_string;
-  int sockfd;
-  std::string cmd1, cmd2;
-  std::stringstream conv1, conv2;
+  if (!OnIoThread()) {
+    return Run<int>([&]() { return SetL2TrigParams(n_bg, low_thresh); });
+  }
 
   clog << "info: " << logstream::info << "setting L2 parameters to N_BG: " << n_bg << " and LOW_THRESH: " << low_thresh << std::endl;
 
-  /* create the command */
-  conv1 << "trig n_bg " << n_bg << std::endl;
-  cmd1 = conv1.str();
-  conv2 << "trig low_thresh " << low_thresh << std::endl;
-  cmd2 = conv2.str();
+  /* only the values which differ from those loaded are sent */
+  CheckSlowCtrl();
+  CommandBatch batch;
+  if (n_bg != this->_loaded.n_bg) {
+    batch.Add("trig n_bg " + std::to_string(n_bg));
+  }
+  if (low_thresh != this->_loaded.low_thresh) {
+    batch.Add("trig low_thresh " + std::to_string(low_thresh));
+  }
 
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
-  Telnet(cmd1, sockfd, false);
-  Telnet(cmd2, sockfd, false);
+  int n_failed = RunBatch(batch);
+  this->_loaded.n_bg = (n_failed == 0) ? n_bg : SLOWCTRL_UNKNOWN;
+  this->_loaded.low_thresh = (n_failed == 0) ? low_thresh : SLOWCTRL_UNKNOWN;
  
-  close(sockfd);
-  return 0;
+  return n_failed;
 }
 
 
 /**
  * get the Zynq version info
+ * read once, and then again after a reboot
  */
 std::string ZynqManager::GetZynqVer() {
 
-  std::string zynq_ver = "";
-  std::string cmd = "instrument ver\n";
-  int sockfd;
-  
-  /* setup the telnet connection */
-  sockfd = ConnectTelnet();
+  {
+    std::unique_lock<std::mutex> lock(this->_m_state);
+    if (!this->_state.zynq_ver.empty()) {
+      return this->_state.zynq_ver;
+    }
+  }
 
   /* ask for the version */
-  zynq_ver = SendRecvTelnet(cmd, sockfd);
+  if (!OnIoThread()) {
+    return Run<std::string>([this]() { return GetZynqVer(); });
+  }
+  std::string zynq_ver = Telnet("instrument ver\n", false);
+
+  std::unique_lock<std::mutex> lock(this->_m_state);
+  this->_state.zynq_ver = zynq_ver;
   
-  close(sockfd);
   return zynq_ver;
 } 
 
+/**
+ * state of the Zynq as last read, without reading it
+ */
+ZynqStateCache ZynqManager::GetState() {
+
+  std::unique_lock<std::mutex> lock(this->_m_state);
+  return this->_state;
+}
+
+/**
+ * forget the state read from the Zynq, so that it is read again
+ * to be used when the state may have changed, such as after a mode change
+ * @param all if true, the firmware version too, such as after a reboot
+ */
+void ZynqManager::ForgetState(bool all) {
+
+  std::unique_lock<std::mutex> lock(this->_m_state);
+  this->_state.inst_status.clear();
+  this->_state.hvps_status.clear();
+  if (all) {
+    this->_state.zynq_ver.clear();
+  }
+}
+
+/**
+ * reply to "instrument status", read again if older than ZYNQ_STATUS_TTL_SEC
+ * @param refresh if true, read again in any case
+ */
+std::string ZynqManager::ReadInstStatus(bool refresh) {
+
+  auto now = std::chrono::steady_clock::now();
+  {
+    std::unique_lock<std::mutex> lock(this->_m_state);
+    if (!refresh && !this->_state.inst_status.empty()
+	&& now - this->_state.inst_time < std::chrono::seconds(ZYNQ_STATUS_TTL_SEC)) {
+      return this->_state.inst_status;
+    }
+  }
+
+  std::string status = Telnet("instrument status\n", false);
+
+  std::unique_lock<std::mutex> lock(this->_m_state);
+  this->_state.inst_status = status;
+  this->_state.inst_time = std::chrono::steady_clock::now();
+
+  return status;
+}
+
+/**
+ * reply to "hvps status gpio", read again if older than ZYNQ_STATUS_TTL_SEC
+ * @param refresh if true, read again in any case
+ */
+std::string ZynqManager::ReadHvpsStatus(bool refresh) {
+
+  auto now = std::chrono::steady_clock::now();
+  {
+    std::unique_lock<std::mutex> lock(this->_m_state);
+    if (!refresh && !this->_state.hvps_status.empty()
+	&& now - this->_state.hvps_time < std::chrono::seconds(ZYNQ_STATUS_TTL_SEC)) {
+      return this->_state.hvps_status;
+    }
+  }
+
+  std::string status = Telnet("hvps status gpio\n", false, LONG_TIMEOUT_MS);
+
+  std::unique_lock<std::mutex> lock(this->_m_state);
+  this->_state.hvps_status = status;
+  this->_state.hvps_time = std::chrono::steady_clock::now();
+
+  return status;
+}
+
 
 /**
  * Hide the corrupted Pixels give in DeadPixelMask.txt
  */
 int ZynqManager::HidePixels() {
+
+  if (!OnIoThread()) {
+    return Run<int>([this]() { return HidePixels(); });
+  }
+
   
   clog << "info: " << logstream::info << "Hiding corrupted pixels" << std::endl;
   
   // Object containing the command list to send by telnet
   DeadPixelMask mask;
+  /* and the pixels found on board by PixelMonitor */
+  DeadPixelMask auto_mask(this->auto_mask_file);
   
   // Check that DI R_USB0 etc are defined in the right place
   int n_max=mask.c2send.size();
+  int n_auto=auto_mask.c2send.size();
   
-  if(n_max>0){
-
-    int sockfd;
-
-    sockfd = ConnectTelnet();
-    
-    for(int i=0;i<n_max;i++){
-
-      Telnet(mask.c2send[i].line,sockfd,true);
-      Telnet(mask.c2send[i].asic,sockfd,true);
-      Telnet(mask.c2send[i].pixel,sockfd,true);
-      Telnet("slowctrl mask 1",sockfd,true);
-    }
-    
-    close(sockfd);
-    
+  /* the desired mask */
+  std::bitset<N_OF_PIXEL_PER_PDM> hidden;
+  for(int i=0;i<n_max;i++){
+    hidden.set((mask.Dead[i].BOARD * N_ASIC + mask.Dead[i].ASIC) * N_OF_PIXELS_PER_PMT + mask.Dead[i].Number);
+  }
+  for(int i=0;i<n_auto;i++){
+    hidden.set((auto_mask.Dead[i].BOARD * N_ASIC + auto_mask.Dead[i].ASIC) * N_OF_PIXELS_PER_PMT + auto_mask.Dead[i].Number);
+  }
+  if(n_max>0 || n_auto>0){
+    clog << "info: " << logstream::info << n_max << " pixels masked by " << mask.readed_file << ", "
+	 << n_auto << " by " << auto_mask.readed_file << std::endl;
   }
   else{
 
@@ -938,6 +1330,37 @@ int ZynqManager::HidePixels() {
     clog << "info: " << logstream::info << "No DeadPixelMask.txt found or the file is incorrect" << std::endl;
     
   }
-  return 0;
+
+  /* only the pixels which differ from the loaded mask are sent, */
+  /* so that the pixels of a loaded mask are unmasked when the files are emptied */
+  CheckSlowCtrl();
+  std::bitset<N_OF_PIXEL_PER_PDM> changed = hidden;
+  if (this->_loaded.mask_known) {
+    changed ^= this->_loaded.mask;
+  }
+  if (changed.none()) {
+    clog << "info: " << logstream::info << (this->_loaded.mask_known ? "pixel mask already loaded" : "no pixels to mask")
+	 << std::endl;
+    return 0;
+  }
+
+  /* consecutive pixels of the same ASIC only need the pixel selection */
+  CommandBatch batch;
+  for(int p=0;p<N_OF_PIXEL_PER_PDM;p++){
+
+    if (!changed[p]) {
+      continue;
+    }
+    batch.Add("slowctrl line " + std::to_string(p / (N_ASIC * N_OF_PIXELS_PER_PMT)));
+    batch.Add("slowctrl asic " + std::to_string((p / N_OF_PIXELS_PER_PMT) % N_ASIC));
+    batch.Add("slowctrl pixel " + std::to_string(p % N_OF_PIXELS_PER_PMT));
+    batch.Add(hidden[p] ? "slowctrl mask 1" : "slowctrl mask 0");
+  }
+    
+  int n_failed = RunBatch(batch);
+  this->_loaded.mask = hidden;
+  this->_loaded.mask_known = (n_failed == 0);
+
+  return n_failed;
 }
 
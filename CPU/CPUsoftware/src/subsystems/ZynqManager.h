@@ -13,18 +13,34 @@
 #include <fcntl.h>
 
 #include <fstream>
+#include <bitset>
 #include <algorithm>
 #include <mutex>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <future>
+#include <functional>
+#include <condition_variable>
 
 #include "log.h"
 #include "CpuTools.h"
+#include "TelnetSession.h"
+#include "CommandBatch.h"
 /*Giammanco include the pxel mask*/
 #include "DeadPixelRead.h"
 
-/* interface to Zynq board */
+/* interface to Zynq board, by default, see SetEndpoint() */
 #define ZYNQ_IP "192.168.7.10"
 #define TELNET_PORT 23
 #define CONNECT_TIMEOUT_SEC 100
+/* backoff of the connection attempts while waiting for the Zynq, in ms */
+#define PROBE_MIN_MS 100
+#define PROBE_MAX_MS 2000
+/* time for the Zynq to drop the connection after the reboot command, in ms */
+#define SHUTDOWN_TIMEOUT_MS 5000
 #define SHORT_TIMEOUT_SEC 2
 
 /* pedestal for the ASIC DAC */
@@ -35,19 +51,90 @@
 #define N_PMT 36
 #define N_ASIC 6
 
-/* time between consecutive telnet commands in mus */
-#define SLEEP_TIME 500000
+/* timeout of the replies to the slower commands (HV, clean) in ms */
+#define LONG_TIMEOUT_MS 10000
+/* time between the steps of the HV ramp in ms */
+#define HV_RAMP_STEP_MS 500
+
+/* time for which a status read from the Zynq is used before it is read again, in s */
+#define ZYNQ_STATUS_TTL_SEC 30
+
+/* duration of a GTU in ns, for the duration of an S-curve */
+#define SCURVE_GTU_NS 2500
+/* time between the checks of the S-curve status in ms */
+#define SCURVE_POLL_MS 100
+/* time after the end of an S-curve in which its file is expected from the FTP server, in ms */
+#define SCURVE_FILE_WAIT_MS 5000
+
+/* key of the status query in the command queue */
+#define ZYNQ_STATUS_KEY "status"
+/* key of the HV off in the command queue, which stops an HV ramp */
+#define ZYNQ_HV_OFF_KEY "hv off"
 
 /* location of Zynq setup files */
 #define ZYNQ_SETUP_SUBDIR "/automated_boot"
 #define MATRIX_DAC_10 "dac10.txt"
 
+/* value of the slow control state which is not known */
+#define SLOWCTRL_UNKNOWN -1
+
+
+/**
+ * slow control state loaded on the Zynq, SLOWCTRL_UNKNOWN where not known
+ */
+struct SlowCtrlState {
+  /**
+   * DAC10 of each PMT, in the order of the dac10.txt matrix
+   */
+  std::vector<int> dac10;
+  /**
+   * masked pixels, indexed by (line * N_ASIC + asic) * N_OF_PIXELS_PER_PMT + pixel
+   */
+  std::bitset<N_OF_PIXEL_PER_PDM> mask;
+  bool mask_known;
+  int n1;
+  int n2;
+  int n_bg;
+  int low_thresh;
+  int test_mode;
+  /**
+   * telnet connection on which the state was loaded
+   */
+  uint32_t n_connect;
+};
+
+
+/**
+ * state of the Zynq as last read, so that it is only read again when it may have changed
+ */
+struct ZynqStateCache {
+  /**
+   * firmware version, empty if not known
+   */
+  std::string zynq_ver;
+  /**
+   * reply to "instrument status", empty if not known
+   */
+  std::string inst_status;
+  std::chrono::steady_clock::time_point inst_time;
+  /**
+   * reply to "hvps status gpio", empty if not known
+   */
+  std::string hvps_status;
+  std::chrono::steady_clock::time_point hvps_time;
+};
+
 
 /**
  * class to handle the Zynq interface. 
  * commands and information are sent and received over telnet
- * using socket programming.
- * data from the Zynq board is placed on the FTP directory
+ * using socket programming, on a connection which is kept open.
+ * data from the Zynq board is placed on the FTP directory.
+ * the public member functions which talk to the Zynq pass themselves to
+ * the I/O thread, in LANE_CONTROL unless stated, when called from another
+ * thread. Run() and Submit() are used to choose the lane, or to run several
+ * of them as one command. CheckConnect(), Restart() and Scurve() are the
+ * exceptions: they wait on the calling thread, and only queue their commands
  */
 class ZynqManager {
 public:
@@ -119,49 +206,198 @@ public:
   /**
    * set to true if the telnet connection is successful 
    */
-  bool telnet_connected;
+  std::atomic<bool> telnet_connected;
   /**
    * vector of EC values (0 <=> off, 1 <=> on)
    */
   std::vector<int> ec_values;
+  /**
+   * vector of the dynode voltage of each EC (HV DAC), set by HvpsTurnOn()
+   */
+  std::vector<int> dv_values;
+  /**
+   * mask written by PixelMonitor, applied by HidePixels() with DeadPixelMask.txt
+   */
+  std::string auto_mask_file;
 
-  /*
-   * to handle Zynq access in a thread safe way
+  /**
+   * priority lanes of the command queue, a lower lane is served first
+   */
+  enum Lane : uint8_t {
+    LANE_URGENT = 0, /* HV off and other safety actions */
+    LANE_CONTROL = 1, /* configuration and acquisition */
+    LANE_STATUS = 2, /* status queries */
+    N_LANES = 3,
+  };
+  /**
+   * time from the last reboot to the Zynq answering again in ms, -1 if not known
    */
-  std::mutex m_zynq;
+  std::atomic<int> boot_to_ready_ms;
+  /**
+   * number of commands answered by a command already in the queue
+   */
+  std::atomic<uint32_t> n_coalesced;
   
-  ZynqManager();
+  ZynqManager(std::string ip = ZYNQ_IP, int port = TELNET_PORT);
+  ~ZynqManager();
+  template <typename T>
+  std::shared_future<T> Submit(std::function<T()> cmd, Lane lane = LANE_CONTROL, const std::string & key = "");
+  template <typename T>
+  T Run(std::function<T()> cmd, Lane lane = LANE_CONTROL, const std::string & key = "");
+  bool HvOffPending();
   int CheckConnect();
-  static int ConnectTelnet();
+  int UpdateStatus();
+  int SetEndpoint(std::string ip, int port);
+  std::string GetIp();
   int GetInstStatus();
   int GetHvpsStatus();
   int HvpsTurnOn(int cv, std::string hvps_dv_string, std::string hvps_ec_string);
   int HvpsTurnOff();
+  int HvpsTurnOffEc(std::vector<int> ec_mask);
+  int HvpsLowerDac(std::vector<int> ec_mask, int dac_step);
   int HidePixels(); /*added by Giammanco*/
   int Scurve(int start, int step, int stop, int acc);
+  int StartScurve(int start, int step, int stop, int acc);
+  static std::chrono::milliseconds ScurveDuration(int start, int step, int stop, int acc);
   int SetDac(int dac_level);
   int AcqShot();
   uint8_t SetZynqMode();
   TestMode SetTestMode();
-  static int StopAcquisition();
+  int StopAcquisition();
   int SetNPkts(int N1, int N2);
   int SetL2TrigParams(int n_bg, int low_thresh); 
-  bool CheckScurve(int sockfd);
-  static std::string GetZynqVer();
+  bool CheckScurve();
+  std::string GetZynqVer();
+  ZynqStateCache GetState();
+  void ForgetState(bool all);
   int InstrumentClean();
   int Reboot();
+  int Restart(std::string setup_script_path, bool hide_pixels);
   int SetMatrixDac10(const std::string &usb_mountpoint, bool debug);
+  int SetMatrixDac10(std::vector<int> dac10_values);
   int Setup(std::string setup_script_path);
+  int RunBatch(CommandBatch & batch);
   
 private:
+
+  /**
+   * telnet connection to the Zynq, kept open between commands
+   */
+  TelnetSession _session;
+  /**
+   * address and telnet port of the Zynq, guarded by _m_state
+   */
+  std::string _ip;
+  int _port;
+  /**
+   * slow control state loaded on the Zynq, so that only changes are sent
+   */
+  SlowCtrlState _loaded;
+  /**
+   * state read from the Zynq, shared with the other threads
+   */
+  ZynqStateCache _state;
+  std::mutex _m_state;
+
+  /**
+   * command of the queue, with its result
+   */
+  struct QueuedCommand {
+    std::string key;
+    std::function<void()> run;
+    std::shared_ptr<void> result;
+  };
+  /**
+   * commands waiting for the I/O thread, in each lane
+   */
+  std::deque<QueuedCommand> _queue[N_LANES];
+  std::mutex _m_queue;
+  std::condition_variable _cv_queue;
+  bool _stop_io;
+  /**
+   * the only thread which talks to the Zynq
+   */
+  std::thread _io_thread;
+  /**
+   * true once dv_values were set by a complete ramp of HvpsTurnOn() in this process,
+   * as the DAC of the Zynq cannot be read back
+   */
+  bool _dv_set;
+  /**
+   * time of the last reboot, while the Zynq is not yet ready again
+   */
+  std::chrono::steady_clock::time_point _reboot_time;
+  bool _rebooting;
   
-  static std::string SendRecvTelnet(std::string send_msg, int sockfd);
-  static int SendTelnet(std::string send_msg, int sockfd);
-  static std::string Telnet(const std::string & send_msg, int sockfd, bool print);
-  static int TelnetSendOnly(std::string send_msg, int sockfd); 
+  void IoLoop();
+  bool OnIoThread();
+  std::string Telnet(const std::string & send_msg, bool print, int timeout_ms = TELNET_TIMEOUT_MS);
+  int TelnetSendOnly(const std::string & send_msg);
   int InstStatusTest(std::string send_msg);
   bool CheckTelnet();  
+  bool ProbeReady(int n_probes);
+  std::string ReadInstStatus(bool refresh = false);
+  std::string ReadHvpsStatus(bool refresh = false);
+  void CheckSlowCtrl();
+  void ForgetSlowCtrl();
 
 };
 
+/**
+ * queue a command for the Zynq I/O thread
+ * a command is run on its own, and the commands of a lane are run in order.
+ * commands run by a queued command, on the I/O thread, are run straight away
+ * @param cmd the command, which calls ZynqManager member functions
+ * @param lane the priority lane of the command
+ * @param key if not empty, a command with the same key already in the queue is not queued again,
+ * and its result is returned instead (the key must always be used with the same type T)
+ * returns the result of the command, once it has been run
+ */
+template <typename T>
+std::shared_future<T> ZynqManager::Submit(std::function<T()> cmd, Lane lane, const std::string & key) {
+
+  std::unique_lock<std::mutex> lock(this->_m_queue);
+
+  /* on the I/O thread, or after it stopped */
+  if (this->_stop_io || OnIoThread()) {
+    lock.unlock();
+    std::packaged_task<T()> task(cmd);
+    std::shared_future<T> result = task.get_future().share();
+    task();
+    return result;
+  }
+
+  /* coalesce with the same command */
+  if (!key.empty()) {
+    for (int l = 0; l < N_LANES; l++) {
+      for (const QueuedCommand & queued : this->_queue[l]) {
+	if (queued.key == key) {
+	  this->n_coalesced++;
+	  return *std::static_pointer_cast<std::shared_future<T>>(queued.result);
+	}
+      }
+    }
+  }
+
+  auto task = std::make_shared<std::packaged_task<T()>>(cmd);
+  auto result = std::make_shared<std::shared_future<T>>(task->get_future().share());
+  this->_queue[lane].push_back({key, [task]() { (*task)(); }, result});
+  lock.unlock();
+  this->_cv_queue.notify_one();
+
+  return *result;
+}
+
+/**
+ * queue a command for the Zynq I/O thread and wait for its result
+ * @param cmd the command, which calls ZynqManager member functions
+ * @param lane the priority lane of the command
+ * @param key see Submit()
+ */
+template <typename T>
+T ZynqManager::Run(std::function<T()> cmd, Lane lane, const std::string & key) {
+
+  return Submit<T>(cmd, lane, key).get();
+}
+
 #endif /* _ZYNQ_INTERFACE_H */
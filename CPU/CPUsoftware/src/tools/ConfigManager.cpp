@@ -15,6 +15,8 @@ ConfigManager::ConfigManager () {
  * constructor
  * @param cfl path to the local configuration file
  * @param cf path to the configuration file to be copied over 
+ * the USB configuration files are looked for on the mountpoints of the local
+ * configuration file if cf0 or cf1 is empty
  */
 ConfigManager::ConfigManager (const std::string & cfl, const std::string & cf0, const std::string & cf1) {
   this->config_file_local = cfl;
@@ -50,6 +52,27 @@ void ConfigManager::Initialise(){
   this->ConfigOut->status_period = -1;
   this->ConfigOut->pwr_on_delay =-1;
   this->ConfigOut->camera_on =-1;
+
+  /* optional parameters, with their default values */
+  this->ConfigOut->dac_tune_rate = DAC_TUNE_RATE_DEFAULT;
+  this->ConfigOut->dac_tune_acc = DAC_TUNE_ACC_DEFAULT;
+  this->ConfigOut->scurve_coarse_step = SCURVE_COARSE_STEP_DEFAULT;
+  this->ConfigOut->pixel_mask_n_sigma = PIXEL_MASK_N_SIGMA_DEFAULT;
+  this->ConfigOut->pixel_mask_persist = PIXEL_MASK_PERSIST_DEFAULT;
+  this->ConfigOut->track_n_sigma = TRACK_N_SIGMA_DEFAULT;
+  this->ConfigOut->track_min_frames = TRACK_MIN_FRAMES_DEFAULT;
+  this->ConfigOut->downlink_budget = DOWNLINK_BUDGET_DEFAULT;
+  this->ConfigOut->downlink_top_k = DOWNLINK_TOP_K_DEFAULT;
+  this->ConfigOut->rate_step_factor = RATE_STEP_FACTOR_DEFAULT;
+  this->ConfigOut->rate_action = RATE_ACTION_DEFAULT;
+  this->ConfigOut->zynq_ip = ZYNQ_IP;
+  this->ConfigOut->telnet_port = TELNET_PORT;
+  this->ConfigOut->data_dir = DATA_DIR;
+  this->ConfigOut->done_dir = DONE_DIR;
+  this->ConfigOut->usb_mountpoint_0 = USB_MOUNTPOINT_0;
+  this->ConfigOut->usb_mountpoint_1 = USB_MOUNTPOINT_1;
+  this->ConfigOut->log_dir = LOG_DIR;
+  this->ConfigOut->state_dir = STATE_DIR;
   
   /* initialise HV switch to be set by InputParser */
   /* stored here to be easily passed around the DataAcquisition */
@@ -60,6 +83,7 @@ void ConfigManager::Initialise(){
   this->ConfigOut->instrument_mode = 0;
   this->ConfigOut->acquisition_mode = 0;
   this->ConfigOut->hvps_log_len = 0;
+  this->ConfigOut->sc_n_thresholds = 0;
   
 }
 
@@ -128,6 +152,9 @@ void ConfigManager::Parse(std::string config_file_name){
       else if (type == "SCURVE_ACC") {
 	in >> this->ConfigOut->scurve_acc;
       }
+      else if (type == "SCURVE_COARSE_STEP") {
+	in >> this->ConfigOut->scurve_coarse_step;
+      }
       else if (type == "DAC_LEVEL") {
 	in >> this->ConfigOut->dac_level;
       } 
@@ -173,6 +200,60 @@ void ConfigManager::Parse(std::string config_file_name){
       else if (type == "CAMERA_ON") {
 	in >> this->ConfigOut->camera_on;
       }
+      else if (type == "DAC_TUNE_RATE") {
+	in >> this->ConfigOut->dac_tune_rate;
+      }
+      else if (type == "DAC_TUNE_ACC") {
+	in >> this->ConfigOut->dac_tune_acc;
+      }
+      else if (type == "PIXEL_MASK_N_SIGMA") {
+	in >> this->ConfigOut->pixel_mask_n_sigma;
+      }
+      else if (type == "PIXEL_MASK_PERSIST") {
+	in >> this->ConfigOut->pixel_mask_persist;
+      }
+      else if (type == "TRACK_N_SIGMA") {
+	in >> this->ConfigOut->track_n_sigma;
+      }
+      else if (type == "TRACK_MIN_FRAMES") {
+	in >> this->ConfigOut->track_min_frames;
+      }
+      else if (type == "DOWNLINK_BUDGET") {
+	in >> this->ConfigOut->downlink_budget;
+      }
+      else if (type == "DOWNLINK_TOP_K") {
+	in >> this->ConfigOut->downlink_top_k;
+      }
+      else if (type == "RATE_STEP_FACTOR") {
+	in >> this->ConfigOut->rate_step_factor;
+      }
+      else if (type == "RATE_ACTION") {
+	in >> this->ConfigOut->rate_action;
+      }
+      else if (type == "ZYNQ_IP") {
+	in >> this->ConfigOut->zynq_ip;
+      }
+      else if (type == "TELNET_PORT") {
+	in >> this->ConfigOut->telnet_port;
+      }
+      else if (type == "DATA_DIR") {
+	in >> this->ConfigOut->data_dir;
+      }
+      else if (type == "DONE_DIR") {
+	in >> this->ConfigOut->done_dir;
+      }
+      else if (type == "USB_MOUNTPOINT_0") {
+	in >> this->ConfigOut->usb_mountpoint_0;
+      }
+      else if (type == "USB_MOUNTPOINT_1") {
+	in >> this->ConfigOut->usb_mountpoint_1;
+      }
+      else if (type == "LOG_DIR") {
+	in >> this->ConfigOut->log_dir;
+      }
+      else if (type == "STATE_DIR") {
+	in >> this->ConfigOut->state_dir;
+      }
       
     }
     cfg_file.close();
@@ -220,6 +301,16 @@ void ConfigManager::Configure() {
     clog << "error: " << logstream::error << "Local configuration file " << config_file_local << " does not exist: start configuration from usb" << std::endl;
     std::cout << "ERROR: local configuration file " << config_file_local << " does not exist: start configuration from usb" << std::endl;
   }
+
+  /* the USB configuration files of this instance */
+  if (this->config_file_usb0.empty()) {
+    this->config_file_usb0 = this->ConfigOut->usb_mountpoint_0 + "/" + CONFIG_FILE_USB;
+    config_file_usb0_name = this->config_file_usb0;
+  }
+  if (this->config_file_usb1.empty()) {
+    this->config_file_usb1 = this->ConfigOut->usb_mountpoint_1 + "/" + CONFIG_FILE_USB;
+    config_file_usb1_name = this->config_file_usb1;
+  }
   
   
   cfg_file_usb0.open(config_file_usb0_name.c_str());
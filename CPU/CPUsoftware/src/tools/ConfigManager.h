@@ -11,6 +11,7 @@
 
 #include "log.h"
 #include "CpuTools.h"
+#include "ZynqManager.h"
 
 #ifndef __APPLE__
 
@@ -28,6 +29,28 @@
 
 #endif /* __APPLE__ */
 
+/* name of the configuration file on each USB mountpoint */
+#define CONFIG_FILE_USB "dummy_usb.conf"
+
+/* defaults for the optional parameters */
+#define DAC_TUNE_RATE_DEFAULT 1000 /* Hz */
+#define DAC_TUNE_ACC_DEFAULT 1024 /* GTU */
+#define SCURVE_COARSE_STEP_DEFAULT 32 /* DAC */
+#define PIXEL_MASK_N_SIGMA_DEFAULT 10
+#define PIXEL_MASK_PERSIST_DEFAULT 12 /* packets */
+#define TRACK_N_SIGMA_DEFAULT 5
+#define TRACK_MIN_FRAMES_DEFAULT 3 /* D3 frames */
+#define DOWNLINK_BUDGET_DEFAULT 50000000 /* bytes */
+#define DOWNLINK_TOP_K_DEFAULT 100 /* D1/D2 blocks */
+#define RATE_STEP_FACTOR_DEFAULT 2
+#define RATE_ACTION_DEFAULT 0 /* log only */
+/* the Zynq is at ZYNQ_IP on TELNET_PORT by default, from ZynqManager.h */
+#define DATA_DIR "/home/minieusouser/DATA"
+#define DONE_DIR "/home/minieusouser/DONE"
+#define USB_MOUNTPOINT_0 "/media/usb0"
+#define USB_MOUNTPOINT_1 "/media/usb1"
+/* the log is in LOG_DIR by default, see log.h, and the files kept between runs in CONFIG_DIR */
+#define STATE_DIR CONFIG_DIR
 
 /**
  * struct for output of the configuration file 
@@ -56,12 +79,32 @@ struct Config {
   int status_period;
   int pwr_on_delay;
   int camera_on;
+  int dac_tune_rate;
+  int dac_tune_acc;
+  int scurve_coarse_step;
+  float pixel_mask_n_sigma;
+  int pixel_mask_persist;
+  float track_n_sigma;
+  int track_min_frames;
+  long downlink_budget;
+  int downlink_top_k;
+  float rate_step_factor;
+  int rate_action;
+  std::string zynq_ip;
+  int telnet_port;
+  std::string data_dir;
+  std::string done_dir;
+  std::string usb_mountpoint_0;
+  std::string usb_mountpoint_1;
+  std::string log_dir;
+  std::string state_dir;
 
   /* set by RunInstrument and InputParser at runtime */
   bool hv_on;
   uint8_t instrument_mode;
   uint8_t acquisition_mode;
   uint32_t hvps_log_len;
+  uint32_t sc_n_thresholds;
   
 };
 
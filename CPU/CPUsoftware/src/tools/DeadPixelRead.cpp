@@ -11,6 +11,14 @@ DeadPixelMask::DeadPixelMask(){
 
      }
 
+/*read a given mask file, such as AUTO_MASK_FILE*/
+DeadPixelMask::DeadPixelMask(std::string filename){
+
+     this->readed_file=filename;
+     ReadDead();
+
+     }
+
 /*Check if the file is in usb1, usb0, local*/
 void DeadPixelMask::Pick_File(){
 
@@ -61,8 +69,6 @@ int DeadPixelMask::ReadDead(){
    if (ifile.is_open()) {
 
     int nline=0;
-    int X; //x and y indices inside of a chip to be converted in pixel number
-    int Y;
     int Npixel;
     
     while(getline (ifile,line)){
@@ -100,9 +106,7 @@ int DeadPixelMask::ReadDead(){
 		pixel.BOARD=nline/8;
 		pixel.ASIC=col/8;
 		pixel.ECU=3*(nline/16)+col/16;
-		X=fmod(nline,8);
-		Y=fmod(col,8);
-		pixel.Number=X*8+Y;
+		pixel.Number=ZynqIndex(nline,col)%N_OF_PIXELS_PER_PMT;
 		
 		cmaskline.line="slowctrl line "+  std::to_string(pixel.BOARD);
 		cmaskline.asic="slowctrl asic "+  std::to_string(pixel.ASIC);
@@ -111,8 +115,6 @@ int DeadPixelMask::ReadDead(){
 		Dead.push_back(pixel);
 		c2send.push_back(cmaskline);
 		
-		std::cout<<'('<<pixel.BOARD<<';'<<pixel.ASIC<<')'<<'('<<nline<<';'<<col<<')'<<pixel.ECU<<','<<X<<','<<Y<<','<<pixel.Number<<std::endl; 
-		
 	      }  
 	      
 	    }
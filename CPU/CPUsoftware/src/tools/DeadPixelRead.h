@@ -10,13 +10,17 @@
 #include <cctype>
 #include <algorithm>
 
-#include <math.h> /*for fmod*/
+#include "minieuso_pixel_map.h"
 
 #include <vector>
 
 #define CONFIG_DIR_M  "/home/software/CPU/CPUsoftware/config"
 #define DIR_USB0  "/media/usb0"
 #define DIR_USB1 "/media/usb1"
+/* mask of the pixels found by PixelMonitor, applied together with DeadPixelMask.txt, */
+/* in the STATE_DIR of the configuration */
+#define AUTO_MASK_FILE_NAME "DeadPixelMask_auto.txt"
+#define AUTO_MASK_FILE CONFIG_DIR_M "/" AUTO_MASK_FILE_NAME
 
 
 /**
@@ -40,6 +44,7 @@ class DeadPixelMask{
     std::string readed_file;
 
     DeadPixelMask();
+    DeadPixelMask(std::string filename);
 
     private:
     void Pick_File();
@@ -27,6 +27,8 @@ InputParser::InputParser(int &argc, char **argv) {
   this->CmdLine->check_status = false;
   this->CmdLine->zynq_reboot = false;
   this->CmdLine->hide_pixel = false;
+  this->CmdLine->dac_tune = false;
+  this->CmdLine->sc_adaptive = false;
   
   this->CmdLine->hvps_dv_string = "";
   this->CmdLine->asic_dac = -1;
@@ -51,7 +53,8 @@ InputParser::InputParser(int &argc, char **argv) {
   this->allowed_tokens = {"-db", "-log", "-comment", "-ver", "-lvps", "-hvswitch", "-help",
 			  "-dv", "-dvr", "-asicdac", "-check_status", "-cam", "-v", "-therm",
 			  "-hv", "-scurve", "-start", "-stop", "-step", "-acc", "-short",
-			  "-test_zynq", "-keep_zynq_pkt", "-zynq", "-subsystem", "-zynq_reboot", "-hide_pixel"};
+			  "-test_zynq", "-keep_zynq_pkt", "-zynq", "-subsystem", "-zynq_reboot", "-hide_pixel",
+			  "-dac_tune", "-adaptive", "-config"};
 
   /* get command line input */
   std::string space = " ";
@@ -70,6 +73,7 @@ InputParser::InputParser(int &argc, char **argv) {
   /* initialise comment field */
   this->CmdLine->comment = "none";
   this->CmdLine->comment_fn = "";
+  this->CmdLine->config_file = "";
 
 }
 
@@ -253,6 +257,9 @@ CmdLineInputs * InputParser::ParseCmdLineInputs() {
     if (!acc_str.empty()) {
       this->CmdLine->sc_acc = std::stoi(acc_str); 
     }
+    if (cmdOptionExists("-adaptive")) {
+      this->CmdLine->sc_adaptive = true;
+    }
     
   }
   if(cmdOptionExists("-zynq")){
@@ -369,6 +376,9 @@ CmdLineInputs * InputParser::ParseCmdLineInputs() {
   if(cmdOptionExists("-keep_zynq_pkt")){
     this->CmdLine->keep_zynq_pkt = true;
   }
+  if(cmdOptionExists("-dac_tune")){
+    this->CmdLine->dac_tune = true;
+  }
   if(cmdOptionExists("-check_status")){
     this->CmdLine->check_status = true;
   }
@@ -397,6 +407,18 @@ CmdLineInputs * InputParser::ParseCmdLineInputs() {
      }
    }
    
+  /* local configuration file, such as one per instance */
+  if(cmdOptionExists("-config")){
+    const std::string &config_str = getCmdOption("-config");
+    if (!config_str.empty()) {
+      this->CmdLine->config_file = config_str;
+    }
+    else {
+      std::cout << "Error: for -config option a configuration file must be provided" << std::endl;
+      return NULL;
+    }
+  }
+   
   /* get the arguments */
   /* dynode voltage */
   const std::string &dynode_voltage = getCmdOption("-dv");
@@ -487,6 +509,7 @@ int InputParser::PrintHelpMsg() {
   std::cout << "-db:                 enter software test/debug mode" << std::endl;
   std::cout << "-log:                turn on logging (off by default)" << std::endl;
   std::cout << "-comment:            add a comment to the CPU file header and name (e.g. -comment \"your comment here\")" << std::endl;
+  std::cout << "-config <FILE>:      use FILE as the local configuration file, instead of dummy_local.conf" << std::endl;
   std::cout << std::endl;
   std::cout << std::endl;
   std::cout << "EXECUTE-AND-EXIT" << std::endl;
@@ -541,6 +564,7 @@ int InputParser::PrintHelpMsg() {
   std::cout << "-step:               step between consecutive ASIC DAC acquisitions" << std::endl; 
   std::cout << "-stop:               stop ASIC DAC for threshold scan (max = 1023)" << std::endl; 
   std::cout << "-acc:                number of GTU taken at each ASIC DAC step" << std::endl; 
+  std::cout << "-adaptive:           coarse scan with SCURVE_COARSE_STEP, then fine scans with -step around the transitions only" << std::endl; 
  
   std::cout << std::endl;
   std::cout << std::endl;
@@ -551,6 +575,7 @@ int InputParser::PrintHelpMsg() {
   std::cout << "-test_zynq <MODE>:   use the Zynq test mode (<MODE> = none, ecasic, pmt, pdm, l1, l2, l3, default = pdm)" << std::endl;
   std::cout << "-keep_zynq_pkt:      keep the Zynq packets on FTP" << std::endl;
   std::cout << "-zynq_reboot:      reboot the Zynq for this acquisition" << std::endl;
+  std::cout << "-dac_tune:           tune the ASIC DAC10 to DAC_TUNE_RATE with a short S-curve before the acquisition" << std::endl;
   std::cout << std::endl;
   std::cout << "Example use case: mecontrol -log -test_zynq pdm -keep_zynq_pkt" << std::endl;
   std::cout << "Example use case: mecontrol -log -hv on -zynq trigger" << std::endl;
@@ -590,7 +615,13 @@ int InputParser::CheckInputs() {
   int error_count = 0;
   
   /* loop over inputs and check validity */
-  for(auto &t : this->tokens) {
+  for(size_t i = 0; i < this->tokens.size(); i++) {
+    const std::string & t = this->tokens[i];
+
+    /* the file name of -config may contain a '-' */
+    if (i > 0 && this->tokens[i - 1] == "-config") {
+      continue;
+    }
       
     /* only check -options */
     if (t.find('-') != std::string::npos) {
@@ -41,6 +41,8 @@ struct CmdLineInputs {
   bool check_status;
   bool zynq_reboot;
   bool hide_pixel;
+  bool dac_tune;
+  bool sc_adaptive;
   /* command line arguments */
   std::string hvps_dv_string;
   int asic_dac;
@@ -65,6 +67,7 @@ struct CmdLineInputs {
   std::string zynq_mode_string;
   std::string comment;
   std::string comment_fn;
+  std::string config_file;
  
 };
 
@@ -0,0 +1,85 @@
+#include "PixelTransform.h"
+
+/**
+ * constructor
+ */
+PixelTransform::PixelTransform() {
+
+}
+
+/**
+ * reorder a frame from the Zynq order to the focal surface
+ * @param frame N_OF_PIXEL_PER_PDM pixels in the Zynq order
+ * @param focal FOCAL_SURFACE_SIZE x FOCAL_SURFACE_SIZE pixels, row major
+ */
+template <typename T>
+void PixelTransform::ToFocal(const T * frame, T * focal) {
+
+  for (int ecasic = 0; ecasic < N_OF_ECASIC_PER_PDM; ecasic++) {
+    for (int pmt = 0; pmt < N_OF_PMT_PER_ECASIC; pmt++) {
+      const T * in = frame + ZynqIndex(ecasic * PMT_SIZE, pmt * PMT_SIZE);
+      T * out = focal + ecasic * PMT_SIZE * FOCAL_SURFACE_SIZE + pmt * PMT_SIZE;
+      for (int r = 0; r < PMT_SIZE; r++) {
+	std::copy(in + r * PMT_SIZE, in + (r + 1) * PMT_SIZE, out + r * FOCAL_SURFACE_SIZE);
+      }
+    }
+  }
+
+}
+
+/**
+ * reorder a frame from the focal surface to the Zynq order
+ * @param focal FOCAL_SURFACE_SIZE x FOCAL_SURFACE_SIZE pixels, row major
+ * @param frame N_OF_PIXEL_PER_PDM pixels in the Zynq order
+ */
+template <typename T>
+void PixelTransform::ToZynq(const T * focal, T * frame) {
+
+  for (int ecasic = 0; ecasic < N_OF_ECASIC_PER_PDM; ecasic++) {
+    for (int pmt = 0; pmt < N_OF_PMT_PER_ECASIC; pmt++) {
+      const T * in = focal + ecasic * PMT_SIZE * FOCAL_SURFACE_SIZE + pmt * PMT_SIZE;
+      T * out = frame + ZynqIndex(ecasic * PMT_SIZE, pmt * PMT_SIZE);
+      for (int r = 0; r < PMT_SIZE; r++) {
+	std::copy(in + r * FOCAL_SURFACE_SIZE, in + r * FOCAL_SURFACE_SIZE + PMT_SIZE, out + r * PMT_SIZE);
+      }
+    }
+  }
+
+}
+
+/**
+ * transpose frames to the time series of each pixel
+ * @param frames n_frames frames in the Zynq order
+ * @param n_frames number of frames
+ * @param series N_OF_PIXEL_PER_PDM x n_frames values, the time series of a pixel is contiguous
+ * @param focal_order if true the pixels are in the order of the focal surface, else in the Zynq order
+ */
+template <typename T>
+void PixelTransform::ToTimeSeries(const T frames[][N_OF_PIXEL_PER_PDM], int n_frames, T * series, bool focal_order) {
+
+  for (int p0 = 0; p0 < N_OF_PIXEL_PER_PDM; p0 += TRANSPOSE_BLOCK) {
+    for (int f0 = 0; f0 < n_frames; f0 += TRANSPOSE_BLOCK) {
+      const int f1 = std::min(f0 + TRANSPOSE_BLOCK, n_frames);
+      for (int p = p0; p < p0 + TRANSPOSE_BLOCK; p++) {
+	T * out = series + (long)(focal_order ? PixelMap::focal_index[p] : p) * n_frames;
+	for (int f = f0; f < f1; f++) {
+	  out[f] = frames[f][p];
+	}
+      }
+    }
+  }
+
+}
+
+template void PixelTransform::ToFocal<uint8_t>(const uint8_t *, uint8_t *);
+template void PixelTransform::ToFocal<uint16_t>(const uint16_t *, uint16_t *);
+template void PixelTransform::ToFocal<uint32_t>(const uint32_t *, uint32_t *);
+template void PixelTransform::ToFocal<float>(const float *, float *);
+template void PixelTransform::ToZynq<uint8_t>(const uint8_t *, uint8_t *);
+template void PixelTransform::ToZynq<uint16_t>(const uint16_t *, uint16_t *);
+template void PixelTransform::ToZynq<uint32_t>(const uint32_t *, uint32_t *);
+template void PixelTransform::ToZynq<float>(const float *, float *);
+template void PixelTransform::ToTimeSeries<uint8_t>(const uint8_t [][N_OF_PIXEL_PER_PDM], int, uint8_t *, bool);
+template void PixelTransform::ToTimeSeries<uint16_t>(const uint16_t [][N_OF_PIXEL_PER_PDM], int, uint16_t *, bool);
+template void PixelTransform::ToTimeSeries<uint32_t>(const uint32_t [][N_OF_PIXEL_PER_PDM], int, uint32_t *, bool);
+template void PixelTransform::ToTimeSeries<float>(const float [][N_OF_PIXEL_PER_PDM], int, float *, bool);
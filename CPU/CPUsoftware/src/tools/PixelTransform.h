@@ -0,0 +1,33 @@
+#ifndef _PIXEL_TRANSFORM_H
+#define _PIXEL_TRANSFORM_H
+
+#include <algorithm>
+#include <stdint.h>
+
+#include "minieuso_pixel_map.h"
+
+/* size of the square blocks of the transposition to time series, 16 kB of D3 data */
+#define TRANSPOSE_BLOCK 64
+
+/**
+ * layout transforms of the PDM frames, between the Zynq pixel order,
+ * the 48 x 48 focal surface and pixel-major time series.
+ * a row of 8 pixels of a PMT is contiguous in both the Zynq order and the
+ * focal surface, so the frames are moved in rows of 8 pixels, and the time
+ * series are transposed in blocks which stay in the cache.
+ * defined for the D1 (uint8_t), D2 (uint16_t) and D3 (uint32_t) data and float
+ */
+class PixelTransform {
+public:
+  PixelTransform();
+
+  template <typename T>
+  static void ToFocal(const T * frame, T * focal);
+  template <typename T>
+  static void ToZynq(const T * focal, T * frame);
+  template <typename T>
+  static void ToTimeSeries(const T frames[][N_OF_PIXEL_PER_PDM], int n_frames, T * series, bool focal_order);
+};
+
+#endif
+/* _PIXEL_TRANSFORM_H */
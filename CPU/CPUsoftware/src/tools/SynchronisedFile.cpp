@@ -24,9 +24,11 @@ SynchronisedFile::SynchronisedFile(std::string path) {
  */
 SynchronisedFile::~SynchronisedFile() {
 
-  /* close the file */
-  fclose(this->_ptr_to_file);
-  this->_ptr_to_file = nullptr;
+  /* close the file, if not already closed */
+  if (this->_ptr_to_file) {
+    fclose(this->_ptr_to_file);
+    this->_ptr_to_file = nullptr;
+  }
 
 }
 
@@ -40,6 +40,7 @@ public:
     VARIABLE_D1 = 1,
     VARIABLE_D2 = 2,
     VARIABLE_HV = 3,
+    VARIABLE_SC = 4,
   };
 
   uint32_t Checksum();
@@ -122,6 +123,16 @@ public:
 	return check;
       }
       
+      break;
+    case VARIABLE_SC:
+
+      check = fwrite(payload, sizeof(*payload), ConfigOut->sc_n_thresholds, this->_ptr_to_file);
+      if (check != size_t(ConfigOut->sc_n_thresholds)) {
+	clog << "error: " << logstream::error << "fwrite failed to " << this->path << ", wrote " << check
+	     << " of " << ConfigOut->sc_n_thresholds << " thresholds, ferror " << ferror(this->_ptr_to_file) << std::endl;
+	return check;
+      }
+      
       break;
    
     }
@@ -1,3 +1,5 @@
+#include <cstdio>
+
 #include "log.h"
 
 std::string log_name = CreateLogname(); 
@@ -22,3 +24,31 @@ std::string CreateLogname(void) {
   strftime(logname, sizeof(logname), kLogCh, now_tm);
   return logname;
 }
+
+/**
+ * move the log file to another directory, such as the LOG_DIR of the configuration
+ * @param log_dir the new directory
+ * if the file cannot be moved, the log continues in a new file in log_dir
+ */
+int MoveLog(std::string log_dir) {
+
+  std::string new_name = log_dir + log_name.substr(log_name.rfind('/'));
+  if (new_name == log_name) {
+    return 0;
+  }
+
+  log_file.close();
+  int ret = std::rename(log_name.c_str(), new_name.c_str());
+  log_file.open(new_name, std::ios::out | std::ios::app);
+  if (!log_file.is_open()) {
+    /* keep the current file */
+    log_file.open(log_name, std::ios::out | std::ios::app);
+    return 1;
+  }
+  if (ret != 0) {
+    clog << "error: " << logstream::error << "cannot move the log, the start is in " << log_name << std::endl;
+  }
+  log_name = new_name;
+
+  return 0;
+}
@@ -16,6 +16,7 @@
 
 /* function declarations */
 std::string CreateLogname(void);
+int MoveLog(std::string log_dir);
 
 /**
  * simple logging class with different output levels and timestamp 
@@ -0,0 +1,787 @@
+#include "ZynqSimulator.h"
+
+/**
+ * xorshift generator of the random background
+ */
+static inline uint64_t XorShift(uint64_t & state) {
+
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+/**
+ * fill the frames of a data level, with a random background or the pattern of a test mode
+ * @param frames the frames, n_frames * N_OF_PIXEL_PER_PDM values
+ * @param n_frames number of frames
+ * @param test_mode the test mode, 0 for the background
+ * @param base lowest value of the background
+ * @param spread_mask mask of the random part of the background
+ * @param rand state of the random background
+ */
+template <typename T>
+static void FillFrames(T * frames, int n_frames, int test_mode, uint32_t base, uint32_t spread_mask, uint64_t & rand) {
+
+  for (int f = 0; f < n_frames; f++) {
+    T * frame = frames + (size_t)f * N_OF_PIXEL_PER_PDM;
+    for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+      switch (test_mode) {
+      case 0:
+	frame[p] = base + (XorShift(rand) & spread_mask);
+	break;
+      case 1: /* ECASIC */
+	frame[p] = p / (N_OF_PIXELS_PER_PMT * N_OF_PMT_PER_ECASIC);
+	break;
+      case 2: /* PMT */
+	frame[p] = p / N_OF_PIXELS_PER_PMT;
+	break;
+      case 3: /* PDM */
+	frame[p] = 1;
+	break;
+      default: /* L1, L2 and L3 */
+	frame[p] = f;
+	break;
+      }
+    }
+  }
+}
+
+/**
+ * default settings, those of the real Zynq
+ */
+SimConfig::SimConfig() {
+
+  this->port = SIM_TELNET_PORT;
+  this->data_dir = SIM_DATA_DIR;
+  this->lifecycle_ms = SIM_LIFECYCLE_MS;
+  this->boot_ms = SIM_BOOT_MS;
+  this->fast = false;
+  this->verbose = false;
+}
+
+/**
+ * constructor
+ * @param config the settings of the simulator
+ */
+ZynqSimulator::ZynqSimulator(SimConfig config) {
+
+  this->_config = config;
+  this->_running = false;
+  this->_reboot = false;
+  this->_listen_fd = -1;
+  this->_n_client_threads = 0;
+  this->n_commands = 0;
+  this->n_files = 0;
+  this->n_reboots = 0;
+
+  this->_n_frm = 0;
+  this->_n_scurve = 0;
+  this->_n_hv = 0;
+  this->_n_gtu = 0;
+  this->_rand = 0x2545F4914F6CDD1DULL;
+  Reset();
+}
+
+/**
+ * destructor
+ */
+ZynqSimulator::~ZynqSimulator() {
+
+  Stop();
+}
+
+/**
+ * state of the Zynq after a boot
+ */
+void ZynqSimulator::Reset() {
+
+  this->_zynq_mode = 0;
+  this->_test_mode = 0;
+  this->_n1 = MAX_PACKETS_L1;
+  this->_n2 = MAX_PACKETS_L2;
+  this->_n_bg = 0;
+  this->_low_thresh = 0;
+  this->_asic = 0;
+  this->_line = 0;
+  this->_pixel = 0;
+  this->_immediate = false;
+  this->_cathode.assign(SIM_N_EC, 0);
+  this->_hv_dac.assign(SIM_N_EC, 0);
+  this->_hv_on.assign(SIM_N_EC, 0);
+  this->_hv_log.clear();
+  this->_scurve = false;
+}
+
+/**
+ * start the telnet server and the data production
+ * returns 0 on success
+ */
+int ZynqSimulator::Start() {
+
+  if (Listen() != 0) {
+    return 1;
+  }
+
+  this->_running = true;
+  this->_server_thread = std::thread(&ZynqSimulator::Serve, this);
+  this->_data_thread = std::thread(&ZynqSimulator::ProduceData, this);
+
+  return 0;
+}
+
+/**
+ * stop the server, close the connections and wait for the threads
+ */
+void ZynqSimulator::Stop() {
+
+  if (!this->_running) {
+    return;
+  }
+  this->_running = false;
+
+  {
+    std::unique_lock<std::mutex> lock(this->_m_state);
+    this->_cv_state.notify_all();
+  }
+  if (this->_server_thread.joinable()) {
+    this->_server_thread.join();
+  }
+  if (this->_data_thread.joinable()) {
+    this->_data_thread.join();
+  }
+
+  /* the client threads end when their connection is shut down */
+  std::unique_lock<std::mutex> lock(this->_m_clients);
+  for (int fd : this->_clients) {
+    shutdown(fd, SHUT_RDWR);
+  }
+  this->_cv_clients.wait(lock, [this] { return this->_n_client_threads == 0; });
+}
+
+/**
+ * open the listening socket of the telnet server
+ * returns 0 on success
+ */
+int ZynqSimulator::Listen() {
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    std::cout << "ERROR: cannot open socket" << std::endl;
+    return 1;
+  }
+
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(this->_config.port);
+  if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+    std::cout << "ERROR: cannot listen on port " << this->_config.port << ": " << strerror(errno) << std::endl;
+    close(fd);
+    return 1;
+  }
+
+  this->_listen_fd = fd;
+  return 0;
+}
+
+/**
+ * accept the telnet connections, each served by its own thread
+ */
+void ZynqSimulator::Serve() {
+
+  while (this->_running) {
+
+    if (this->_reboot) {
+      Boot();
+      continue;
+    }
+    if (this->_listen_fd < 0 && Listen() != 0) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      continue;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = this->_listen_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 100) <= 0 || !(pfd.revents & POLLIN)) {
+      continue;
+    }
+
+    int fd = accept(this->_listen_fd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    if (this->_config.verbose) {
+      std::cout << "telnet connection accepted" << std::endl;
+    }
+
+    std::unique_lock<std::mutex> lock(this->_m_clients);
+    this->_clients.insert(fd);
+    this->_n_client_threads++;
+    std::thread(&ZynqSimulator::Client, this, fd).detach();
+  }
+
+  if (this->_listen_fd >= 0) {
+    close(this->_listen_fd);
+    this->_listen_fd = -1;
+  }
+}
+
+/**
+ * reboot: drop the connections, and refuse them until the boot is over
+ */
+void ZynqSimulator::Boot() {
+
+  std::cout << "rebooting, back in " << this->_config.boot_ms << " ms" << std::endl;
+
+  close(this->_listen_fd);
+  this->_listen_fd = -1;
+  {
+    std::unique_lock<std::mutex> lock(this->_m_clients);
+    for (int fd : this->_clients) {
+      shutdown(fd, SHUT_RDWR);
+    }
+  }
+
+  auto boot_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(this->_config.boot_ms);
+  while (this->_running && std::chrono::steady_clock::now() < boot_end) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(this->_m_state);
+    Reset();
+  }
+  this->n_reboots++;
+  this->_reboot = false;
+  std::cout << "boot complete" << std::endl;
+}
+
+/**
+ * answer the commands of a telnet connection, in order, until it is closed
+ * @param fd socket of the connection
+ */
+void ZynqSimulator::Client(int fd) {
+
+  std::string rx;
+  char buffer[1024];
+  bool done = false;
+
+  while (!done && this->_running) {
+
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+      break;
+    }
+    rx.append(buffer, n);
+
+    /* one command per line */
+    size_t end;
+    while (!done && (end = rx.find('\n')) != std::string::npos) {
+      std::string cmd = rx.substr(0, end);
+      rx.erase(0, end + 1);
+      cmd.erase(cmd.find_last_not_of(" \r\t") + 1);
+      if (cmd.empty()) {
+	continue;
+      }
+
+      int delay_ms = 0;
+      bool reboot = false;
+      std::string reply = Reply(cmd, delay_ms, reboot);
+      if (this->_config.verbose) {
+	std::cout << "> " << cmd << std::endl << "< " << reply << std::endl;
+      }
+
+      /* the reboot command is not answered */
+      if (reboot) {
+	this->_reboot = true;
+	done = true;
+	break;
+      }
+
+      if (!this->_config.fast && delay_ms > 0) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+      }
+      reply += "\r\n";
+      if (send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) != (ssize_t)reply.size()) {
+	done = true;
+      }
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(this->_m_clients);
+  this->_clients.erase(fd);
+  close(fd);
+  this->_n_client_threads--;
+  this->_cv_clients.notify_all();
+}
+
+/**
+ * read the values of the N_EC EC units of a HV command
+ * @param args the arguments of the command
+ * @param values the values read, unchanged on error
+ * @param max highest value allowed
+ * returns an empty string on success, or the error reply
+ */
+std::string ZynqSimulator::SetEc(std::istringstream & args, std::vector<int> & values, int max) {
+
+  std::vector<int> read;
+  int value;
+  while (args >> value) {
+    if (value < 0 || value > max) {
+      return "ERROR: value out of range";
+    }
+    read.push_back(value);
+  }
+  if (read.size() != SIM_N_EC) {
+    return "ERROR: expected " + std::to_string(SIM_N_EC) + " values";
+  }
+
+  values = read;
+  return "";
+}
+
+/**
+ * the reply of the Zynq to a telnet command
+ * @param cmd the command, without the end of line
+ * @param delay_ms the time the Zynq takes to answer
+ * @param reboot set to true for the reboot command, which is not answered
+ */
+std::string ZynqSimulator::Reply(const std::string & cmd, int & delay_ms, bool & reboot) {
+
+  std::istringstream args(cmd);
+  std::string group, name;
+  int value = 0;
+  args >> group >> name;
+
+  delay_ms = SIM_REPLY_MS;
+  reboot = false;
+  this->n_commands++;
+
+  std::unique_lock<std::mutex> lock(this->_m_state);
+
+  if (group == "reboot") {
+    reboot = true;
+    return "";
+  }
+
+  if (group == "instrument") {
+    if (name == "status") {
+      return "40 " + std::to_string(this->_zynq_mode);
+    }
+    if (name == "ver") {
+      return MINIEUSO_ZYNQ_VER_STRING;
+    }
+    if (name == "mode" && args >> value) {
+      if (value < 0 || value > 63) {
+	return "ERROR: unknown mode";
+      }
+      this->_zynq_mode = value;
+      this->_cv_state.notify_all();
+      return "Ok";
+    }
+    if (name == "clean") {
+      delay_ms = SIM_CLEAN_MS;
+      return "Ok";
+    }
+  }
+
+  if (group == "acq") {
+    if (name == "scurve") {
+      std::string arg;
+      args >> arg;
+      if (arg == "status") {
+	return this->_scurve ? "GatheringInProgress=1" : "GatheringInProgress=0";
+      }
+
+      int start, step, stop, acc;
+      std::istringstream scan_args(arg);
+      if (!(scan_args >> start) || !(args >> step >> stop >> acc)
+	  || start < 0 || step <= 0 || stop < start || stop >= NMAX_OF_THESHOLDS || acc <= 0) {
+	return "ERROR: bad S-curve parameters";
+      }
+      if (this->_scurve) {
+	return "ERROR: S-curve in progress";
+      }
+
+      /* the scan takes acc GTU at each threshold */
+      int n_thresholds = (stop - start) / step + 1;
+      this->_scurve = true;
+      this->_scurve_start = start;
+      this->_scurve_step = step;
+      this->_scurve_stop = stop;
+      this->_scurve_acc = acc;
+      this->_scurve_end = std::chrono::steady_clock::now()
+	+ std::chrono::nanoseconds((int64_t)n_thresholds * acc * SIM_GTU_NS);
+      this->_cv_state.notify_all();
+      return "Ok";
+    }
+    if (name == "test" && args >> value) {
+      if (value < 0 || value > 6) {
+	return "ERROR: unknown test mode";
+      }
+      this->_test_mode = value;
+      return "Ok";
+    }
+    if (name == "shot") {
+      this->_immediate = true;
+      return "Ok";
+    }
+  }
+
+  if (group == "mmg" && args >> value) {
+    if (name == "N1" && value >= 0 && value <= MAX_PACKETS_L1) {
+      this->_n1 = value;
+      return "Ok";
+    }
+    if (name == "N2" && value >= 0 && value <= MAX_PACKETS_L2) {
+      this->_n2 = value;
+      return "Ok";
+    }
+    return "ERROR: bad number of packets";
+  }
+
+  if (group == "trig" && args >> value && value >= 0) {
+    if (name == "n_bg") {
+      this->_n_bg = value;
+      return "Ok";
+    }
+    if (name == "low_thresh") {
+      this->_low_thresh = value;
+      return "Ok";
+    }
+  }
+
+  if (group == "slowctrl") {
+    if (name == "apply") {
+      delay_ms = SIM_APPLY_MS;
+      return "Ok";
+    }
+    if (name == "all") {
+      std::string dac;
+      if (args >> dac >> value && dac == "dac" && value >= 0 && value <= SIM_MAX_DAC10) {
+	delay_ms = SIM_APPLY_MS;
+	return "Ok";
+      }
+      return "ERROR: bad DAC value";
+    }
+    if (!(args >> value)) {
+      return "ERROR: missing value";
+    }
+    if (name == "asic" && value >= 0 && value < SIM_N_ASIC) {
+      this->_asic = value;
+      return "Ok";
+    }
+    if (name == "line" && value >= 0 && value < SIM_N_LINE) {
+      this->_line = value;
+      return "Ok";
+    }
+    if (name == "pixel" && value >= 0 && value < N_OF_PIXELS_PER_PMT) {
+      this->_pixel = value;
+      return "Ok";
+    }
+    if (name == "dac10" && value >= 0 && value <= SIM_MAX_DAC10) {
+      return "Ok";
+    }
+    if (name == "mask" && (value == 0 || value == 1)) {
+      return "Ok";
+    }
+    return "ERROR: bad slow control value";
+  }
+
+  if (group == "hvps") {
+    delay_ms = SIM_HVPS_MS;
+    if (name == "status") {
+      std::string status;
+      for (int i = 0; i < SIM_N_EC; i++) {
+	status += (i ? " " : "") + std::to_string(this->_hv_on[i]);
+      }
+      return status;
+    }
+
+    std::vector<int> values;
+    std::string error;
+    if (name == "cathode") {
+      error = SetEc(args, this->_cathode, 3);
+      if (error.empty()) {
+	LogHv(HVPS_SR_LOADED);
+      }
+    }
+    else if (name == "setdac") {
+      error = SetEc(args, this->_hv_dac, SIM_MAX_HV_DAC);
+      if (error.empty()) {
+	LogHv(HVPS_DACS_LOADED);
+      }
+    }
+    else if (name == "turnon" || name == "turnoff") {
+      error = SetEc(args, values, 1);
+      if (error.empty()) {
+	for (int i = 0; i < SIM_N_EC; i++) {
+	  if (values[i] == 1) {
+	    this->_hv_on[i] = (name == "turnon") ? 1 : 0;
+	  }
+	}
+	LogHv((name == "turnon") ? HVPS_TURN_ON : HVPS_TURN_OFF);
+      }
+    }
+    else {
+      error = "ERROR: unknown command";
+    }
+    return error.empty() ? "Ok" : error;
+  }
+
+  return "ERROR: unknown command";
+}
+
+/**
+ * state of the EC units in the HVPS log, two bits each
+ */
+uint32_t ZynqSimulator::HvChannels() {
+
+  uint32_t channels = 0;
+  for (int i = 0; i < SIM_N_EC; i++) {
+    if (this->_hv_on[i]) {
+      channels |= (1 << (2 * i));
+    }
+  }
+  return channels;
+}
+
+/**
+ * add a record to the HVPS log, written at the end of the lifecycle
+ * @param record_type one of the HVPS_ record types
+ */
+void ZynqSimulator::LogHv(uint32_t record_type) {
+
+  if (this->_hv_log.size() >= HVPS_LOG_SIZE_NRECORDS) {
+    return;
+  }
+
+  DATA_TYPE_HVPS_LOG_V1 record;
+  record.ts.n_gtu = this->_n_gtu;
+  record.ts.unix_time = time(NULL);
+  record.record_type = record_type;
+  record.channels = HvChannels();
+  this->_hv_log.push_back(record);
+}
+
+/**
+ * write the files of the Zynq: a frm_cc file every lifecycle while an
+ * acquisition mode is set, the S-curve as soon as its scan is over, and
+ * the HVPS log at the end of each lifecycle with HV commands
+ */
+void ZynqSimulator::ProduceData() {
+
+  auto lifecycle = std::chrono::milliseconds(this->_config.lifecycle_ms);
+  auto next = std::chrono::steady_clock::now() + lifecycle;
+
+  std::unique_lock<std::mutex> lock(this->_m_state);
+  while (this->_running) {
+
+    auto wake = next;
+    if (this->_scurve && this->_scurve_end < wake) {
+      wake = this->_scurve_end;
+    }
+    this->_cv_state.wait_until(lock, wake);
+    if (!this->_running) {
+      break;
+    }
+    auto now = std::chrono::steady_clock::now();
+
+    /* the files are written without holding the state, so that the commands are still answered */
+    if (this->_scurve && now >= this->_scurve_end) {
+      uint32_t num = this->_n_scurve++;
+      int start = this->_scurve_start;
+      int step = this->_scurve_step;
+      int stop = this->_scurve_stop;
+      int acc = this->_scurve_acc;
+      lock.unlock();
+      WriteScurve(num, start, step, stop, acc);
+      lock.lock();
+      this->_scurve = false;
+    }
+
+    if (now < next) {
+      continue;
+    }
+    this->_n_gtu += N_FRAMES_PER_LIFECYCLE;
+    next += lifecycle;
+    if (next < now) {
+      next = now + lifecycle;
+    }
+
+    if (this->_zynq_mode != 0 && !this->_scurve) {
+      SimPacket pkt;
+      pkt.num = this->_n_frm++;
+      pkt.n_gtu = this->_n_gtu;
+      pkt.zynq_mode = this->_zynq_mode;
+      pkt.test_mode = this->_test_mode;
+      pkt.n1 = this->_n1;
+      pkt.n2 = this->_n2;
+      pkt.immediate = this->_immediate;
+      pkt.hv_status = HvChannels();
+      memset(pkt.cathode_status, 0, sizeof(pkt.cathode_status));
+      for (int i = 0; i < SIM_N_EC; i++) {
+	pkt.cathode_status[i] = this->_cathode[i];
+      }
+      this->_immediate = false;
+      lock.unlock();
+      WritePacket(pkt);
+      lock.lock();
+    }
+
+    if (!this->_hv_log.empty()) {
+      std::vector<DATA_TYPE_HVPS_LOG_V1> records;
+      records.swap(this->_hv_log);
+      uint32_t num = this->_n_hv++;
+      lock.unlock();
+      WriteHvLog(num, records);
+      lock.lock();
+    }
+  }
+}
+
+/**
+ * write a file into the data directory, in one go as at the end of an FTP upload
+ * @param name the file name
+ * @param data the contents
+ * returns 0 on success
+ */
+int ZynqSimulator::WriteFile(const std::string & name, const std::vector<char> & data) {
+
+  std::string path = this->_config.data_dir + "/" + name;
+  FILE * ptr_file = fopen(path.c_str(), "wb");
+  if (!ptr_file) {
+    std::cout << "ERROR: cannot open " << path << ": " << strerror(errno) << std::endl;
+    return 1;
+  }
+  size_t check = fwrite(data.data(), data.size(), 1, ptr_file);
+  fclose(ptr_file);
+  if (check != 1) {
+    std::cout << "ERROR: cannot write " << path << std::endl;
+    return 1;
+  }
+
+  this->n_files++;
+  if (this->_config.verbose) {
+    std::cout << "wrote " << path << " (" << data.size() << " bytes)" << std::endl;
+  }
+  return 0;
+}
+
+/**
+ * write the frm_cc file of a lifecycle: N1 L1 packets, N2 L2 packets and the L3 packet
+ * @param pkt state of the Zynq at the end of the lifecycle
+ */
+int ZynqSimulator::WritePacket(const SimPacket & pkt) {
+
+  size_t size = pkt.n1 * sizeof(Z_DATA_TYPE_SCI_L1_V2) + pkt.n2 * sizeof(Z_DATA_TYPE_SCI_L2_V2)
+    + sizeof(Z_DATA_TYPE_SCI_L3_V2);
+  std::vector<char> data(size, 0);
+  char * next = data.data();
+
+  uint32_t trig_type = TRIG_PERIODIC;
+  if (pkt.immediate && (pkt.zynq_mode & SIM_MODE_IMMEDIATE)) {
+    trig_type = TRIG_IMMEDIATE;
+  }
+  else if (pkt.zynq_mode & SIM_MODE_SELF) {
+    trig_type = TRIG_SELF;
+  }
+  uint32_t unix_time = time(NULL);
+
+  /* the structures are packed, so they can be placed anywhere in the file */
+  for (int i = 0; i < pkt.n1; i++) {
+    Z_DATA_TYPE_SCI_L1_V2 * l1 = reinterpret_cast<Z_DATA_TYPE_SCI_L1_V2 *>(next);
+    l1->zbh.header = BuildHeader(DATA_TYPE_SCI_L1, SIM_VER_PKT);
+    l1->zbh.payload_size = sizeof(DATA_TYPE_SCI_L1_V2);
+    l1->payload.ts.n_gtu = pkt.n_gtu + i * N_FRAMES_PER_LIFECYCLE / (pkt.n1 + 1);
+    l1->payload.ts.unix_time = unix_time;
+    l1->payload.trig_type = trig_type;
+    memcpy(l1->payload.cathode_status, pkt.cathode_status, sizeof(pkt.cathode_status));
+    FillFrames(&l1->payload.raw_data[0][0], N_OF_FRAMES_L1_V0, pkt.test_mode, 0, 0x3, this->_rand);
+    next += sizeof(Z_DATA_TYPE_SCI_L1_V2);
+  }
+
+  for (int i = 0; i < pkt.n2; i++) {
+    Z_DATA_TYPE_SCI_L2_V2 * l2 = reinterpret_cast<Z_DATA_TYPE_SCI_L2_V2 *>(next);
+    l2->zbh.header = BuildHeader(DATA_TYPE_SCI_L2, SIM_VER_PKT);
+    l2->zbh.payload_size = sizeof(DATA_TYPE_SCI_L2_V2);
+    l2->payload.ts.n_gtu = pkt.n_gtu + i * N_FRAMES_PER_LIFECYCLE / (pkt.n2 + 1);
+    l2->payload.ts.unix_time = unix_time;
+    l2->payload.trig_type = trig_type;
+    memcpy(l2->payload.cathode_status, pkt.cathode_status, sizeof(pkt.cathode_status));
+    FillFrames(&l2->payload.int16_data[0][0], N_OF_FRAMES_L2_V0, pkt.test_mode, 160, 0x3f, this->_rand);
+    next += sizeof(Z_DATA_TYPE_SCI_L2_V2);
+  }
+
+  Z_DATA_TYPE_SCI_L3_V2 * l3 = reinterpret_cast<Z_DATA_TYPE_SCI_L3_V2 *>(next);
+  l3->zbh.header = BuildHeader(DATA_TYPE_SCI_L3, SIM_VER_PKT);
+  l3->zbh.payload_size = sizeof(DATA_TYPE_SCI_L3_V2);
+  l3->payload.ts.n_gtu = pkt.n_gtu;
+  l3->payload.ts.unix_time = unix_time;
+  l3->payload.trig_type = TRIG_PERIODIC;
+  memcpy(l3->payload.cathode_status, pkt.cathode_status, sizeof(pkt.cathode_status));
+  l3->payload.hv_status = pkt.hv_status;
+  FillFrames(&l3->payload.int32_data[0][0], N_OF_FRAMES_L3_V0, pkt.test_mode, 24000, 0x3ff, this->_rand);
+
+  char name[32];
+  snprintf(name, sizeof(name), FILENAME_CONCATED, pkt.num);
+  return WriteFile(name, data);
+}
+
+/**
+ * write the S-curve file: the counts of each pixel at each threshold of the scan
+ * each pixel has its own pedestal, below which it counts at every GTU
+ */
+int ZynqSimulator::WriteScurve(uint32_t num, int start, int step, int stop, int acc) {
+
+  int n_thresholds = (stop - start) / step + 1;
+  size_t row_size = N_OF_PIXEL_PER_PDM * sizeof(uint32_t);
+  std::vector<char> data(sizeof(ZynqBoardHeader) + n_thresholds * row_size, 0);
+
+  ZynqBoardHeader * zbh = reinterpret_cast<ZynqBoardHeader *>(data.data());
+  zbh->header = BuildHeader(DATA_TYPE_SCURVE, SIM_VER_SCURVE);
+  zbh->payload_size = n_thresholds * row_size;
+
+  uint32_t * counts = reinterpret_cast<uint32_t *>(data.data() + sizeof(ZynqBoardHeader));
+  for (int t = 0; t < n_thresholds; t++) {
+    int threshold = start + t * step;
+    for (int p = 0; p < N_OF_PIXEL_PER_PDM; p++) {
+      double pedestal = 200 + (p * 37) % 64;
+      double fraction = 1.0 / (1.0 + std::exp((threshold - pedestal) / 8.0));
+      counts[(size_t)t * N_OF_PIXEL_PER_PDM + p] = (uint32_t)(acc * fraction);
+    }
+  }
+
+  char name[32];
+  snprintf(name, sizeof(name), FILENAME_SCURVE, num);
+  return WriteFile(name, data);
+}
+
+/**
+ * write the HVPS log of the lifecycle
+ * @param num number of the file
+ * @param records the records of the lifecycle
+ */
+int ZynqSimulator::WriteHvLog(uint32_t num, const std::vector<DATA_TYPE_HVPS_LOG_V1> & records) {
+
+  size_t payload_size = records.size() * sizeof(DATA_TYPE_HVPS_LOG_V1);
+  std::vector<char> data(sizeof(ZynqBoardHeader) + payload_size, 0);
+
+  ZynqBoardHeader * zbh = reinterpret_cast<ZynqBoardHeader *>(data.data());
+  zbh->header = BuildHeader(DATA_TYPE_HV_STATUS, SIM_VER_HV);
+  zbh->payload_size = payload_size;
+  memcpy(data.data() + sizeof(ZynqBoardHeader), records.data(), payload_size);
+
+  char name[32];
+  snprintf(name, sizeof(name), FILENAME_HVLOG, num);
+  return WriteFile(name, data);
+}
@@ -0,0 +1,196 @@
+#ifndef _ZYNQ_SIMULATOR_H
+#define _ZYNQ_SIMULATOR_H
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+
+#include "minieuso_pdmdata.h"
+
+/* defaults of the stand-in, those of the real Zynq and CPU */
+#define SIM_TELNET_PORT 23
+#define SIM_DATA_DIR "/home/minieusouser/DATA"
+/* one lifecycle of the Zynq, 5.24288 s, in ms */
+#define SIM_LIFECYCLE_MS 5243
+/* time from the reboot command to the telnet server being up again, in ms */
+#define SIM_BOOT_MS 15000
+
+/* reply times of the commands in ms: most, "slowctrl apply", the HV and "instrument clean" */
+#define SIM_REPLY_MS 2
+#define SIM_APPLY_MS 30
+#define SIM_HVPS_MS 150
+#define SIM_CLEAN_MS 200
+/* a GTU of the S-curve scan in ns */
+#define SIM_GTU_NS 2500
+
+/* geometry of the PDM as seen by the slow control and the HV */
+#define SIM_N_EC 9
+#define SIM_N_ASIC N_OF_ECASIC_PER_PDM
+#define SIM_N_LINE N_OF_PMT_PER_ECASIC
+#define SIM_MAX_DAC10 1023
+#define SIM_MAX_HV_DAC 4095
+/* acquisition mode bits, as in ZynqManager::ZynqMode */
+#define SIM_MODE_SELF 4
+#define SIM_MODE_IMMEDIATE 8
+#define SIM_VER_PKT 2
+#define SIM_VER_SCURVE 1
+#define SIM_VER_HV 1
+
+
+/**
+ * settings of a ZynqSimulator, from the command line of zynqsim
+ */
+struct SimConfig {
+  int port;
+  std::string data_dir;
+  int lifecycle_ms;
+  int boot_ms;
+  /**
+   * if true, the commands are answered with no delay
+   */
+  bool fast;
+  bool verbose;
+
+  SimConfig();
+};
+
+
+/**
+ * state of the Zynq at the end of a lifecycle, for the frm_cc file
+ */
+struct SimPacket {
+  uint32_t num;
+  uint32_t n_gtu;
+  int zynq_mode;
+  int test_mode;
+  int n1;
+  int n2;
+  bool immediate;
+  uint32_t hv_status;
+  uint8_t cathode_status[12];
+};
+
+
+/**
+ * stand-in for the Zynq board of the PDM, for local runs of mecontrol.
+ * answers the telnet commands used by ZynqManager, one line per command,
+ * with reply times close to those of the real board, and writes the
+ * frm_cc, scurve and hv files into the data directory of the CPU, as the
+ * FTP uploads of the Zynq do, in the layouts of minieuso_pdmdata.h.
+ * a frm_cc file is written every lifecycle while an acquisition mode is
+ * set, an S-curve file when its scan is over, and an hv file at the end of
+ * each lifecycle with HV commands. the reboot command drops the connection,
+ * and no connection is accepted until the boot is over
+ */
+class ZynqSimulator {
+public:
+  /**
+   * number of commands answered, files written and reboots since the start
+   */
+  std::atomic<uint32_t> n_commands;
+  std::atomic<uint32_t> n_files;
+  std::atomic<uint32_t> n_reboots;
+
+  ZynqSimulator(SimConfig config);
+  ~ZynqSimulator();
+  int Start();
+  void Stop();
+  std::string Reply(const std::string & cmd, int & delay_ms, bool & reboot);
+
+private:
+  SimConfig _config;
+  std::atomic<bool> _running;
+  std::atomic<bool> _reboot;
+  int _listen_fd;
+  std::thread _server_thread;
+  std::thread _data_thread;
+
+  /**
+   * sockets of the connected clients, and number of client threads running
+   */
+  std::set<int> _clients;
+  int _n_client_threads;
+  std::mutex _m_clients;
+  std::condition_variable _cv_clients;
+
+  /**
+   * state of the Zynq, set by the commands
+   */
+  std::mutex _m_state;
+  std::condition_variable _cv_state;
+  int _zynq_mode;
+  int _test_mode;
+  int _n1;
+  int _n2;
+  int _n_bg;
+  int _low_thresh;
+  int _asic;
+  int _line;
+  int _pixel;
+  bool _immediate;
+  std::vector<int> _cathode;
+  std::vector<int> _hv_dac;
+  std::vector<int> _hv_on;
+  std::vector<DATA_TYPE_HVPS_LOG_V1> _hv_log;
+
+  /**
+   * S-curve scan in progress, written when _scurve_end is reached
+   */
+  bool _scurve;
+  int _scurve_start;
+  int _scurve_step;
+  int _scurve_stop;
+  int _scurve_acc;
+  std::chrono::steady_clock::time_point _scurve_end;
+
+  /**
+   * counters of the files, as in their names, and of the GTU
+   */
+  uint32_t _n_frm;
+  uint32_t _n_scurve;
+  uint32_t _n_hv;
+  uint32_t _n_gtu;
+  /**
+   * state of the random background, only used by the data thread
+   */
+  uint64_t _rand;
+
+  void Reset();
+  int Listen();
+  void Serve();
+  void Boot();
+  void Client(int fd);
+  void ProduceData();
+  int WriteFile(const std::string & name, const std::vector<char> & data);
+  int WritePacket(const SimPacket & pkt);
+  int WriteScurve(uint32_t num, int start, int step, int stop, int acc);
+  int WriteHvLog(uint32_t num, const std::vector<DATA_TYPE_HVPS_LOG_V1> & records);
+  void LogHv(uint32_t record_type);
+  uint32_t HvChannels();
+  std::string SetEc(std::istringstream & args, std::vector<int> & values, int max);
+};
+
+#endif
+/* _ZYNQ_SIMULATOR_H */
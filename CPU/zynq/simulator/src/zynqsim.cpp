@@ -0,0 +1,91 @@
+/*-------------------------------
+                                 
+Mini-EUSO Zynq stand-in                 
+https://github.com/cescalara
+                                  
+--------------------------------*/
+#include "zynqsim.h"
+
+/**
+ * print the command line options
+ */
+static void PrintHelp() {
+
+  std::cout << "Stand-in for the Zynq board, for local runs of mecontrol" << std::endl;
+  std::cout << std::endl;
+  std::cout << "usage: zynqsim [-port N] [-data_dir DIR] [-period MS] [-boot MS] [-fast] [-v]" << std::endl;
+  std::cout << std::endl;
+  std::cout << "-port:     telnet port, default " << SIM_TELNET_PORT << std::endl;
+  std::cout << "-data_dir: where the Zynq files are written, default " << SIM_DATA_DIR << std::endl;
+  std::cout << "-period:   lifecycle in ms, default " << SIM_LIFECYCLE_MS << std::endl;
+  std::cout << "-boot:     boot time after a reboot in ms, default " << SIM_BOOT_MS << std::endl;
+  std::cout << "-fast:     answer the commands with no delay" << std::endl;
+  std::cout << "-v:        print the commands and the files written" << std::endl;
+}
+
+/* main program */
+/*--------------*/
+int main(int argc, char ** argv) {
+
+  SimConfig config;
+
+  /* parse command line options */
+  for (int i = 1; i < argc; i++) {
+    std::string opt = argv[i];
+    bool has_value = (i + 1 < argc);
+    if (opt == "-port" && has_value) {
+      config.port = atoi(argv[++i]);
+    }
+    else if (opt == "-data_dir" && has_value) {
+      config.data_dir = argv[++i];
+    }
+    else if (opt == "-period" && has_value) {
+      config.lifecycle_ms = atoi(argv[++i]);
+    }
+    else if (opt == "-boot" && has_value) {
+      config.boot_ms = atoi(argv[++i]);
+    }
+    else if (opt == "-fast") {
+      config.fast = true;
+    }
+    else if (opt == "-v") {
+      config.verbose = true;
+    }
+    else if (opt == "-help") {
+      PrintHelp();
+      return 0;
+    }
+    else {
+      std::cout << "ERROR: unknown option " << opt << std::endl;
+      PrintHelp();
+      return 1;
+    }
+  }
+  if (config.port <= 0 || config.lifecycle_ms <= 0 || config.boot_ms < 0) {
+    std::cout << "ERROR: bad option value" << std::endl;
+    return 1;
+  }
+
+  /* run until CTRL-C */
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  ZynqSimulator Zynq(config);
+  if (Zynq.Start() != 0) {
+    return 1;
+  }
+  std::cout << "Zynq stand-in on port " << config.port << ", writing to " << config.data_dir
+	    << " every " << config.lifecycle_ms << " ms" << std::endl;
+
+  int sig;
+  sigwait(&signals, &sig);
+
+  Zynq.Stop();
+  std::cout << "answered " << Zynq.n_commands << " commands, wrote " << Zynq.n_files
+	    << " files, " << Zynq.n_reboots << " reboots" << std::endl;
+
+  return 0;
+}
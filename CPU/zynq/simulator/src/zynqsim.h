@@ -0,0 +1,12 @@
+#ifndef _ZYNQSIM_H
+#define _ZYNQSIM_H
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string>
+#include <iostream>
+
+#include "ZynqSimulator.h"
+
+#endif
+/* _ZYNQSIM_H */
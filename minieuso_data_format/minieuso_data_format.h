@@ -14,13 +14,14 @@
 #include <vector>
 
 #include "minieuso_pdmdata.h"
+#include "minieuso_pixel_map.h"
 
 /*
  * software definitions
  */
 
-#define VERSION 9.5
-#define VERSION_DATE_STRING "13/10/2020"
+#define VERSION 9.9
+#define VERSION_DATE_STRING "19/10/2026"
 
 /*
  * instrument definitions 
@@ -99,9 +100,17 @@ typedef struct
 #define CPU_FILE_TYPE 'C'
 #define SC_FILE_TYPE 'S'  
 #define HV_FILE_TYPE 'H'  
+#define QL_FILE_TYPE 'L'
+#define LC_FILE_TYPE 'N'
+#define DOWNLINK_FILE_TYPE 'D'
+#define L4_FILE_TYPE 'I'
 #define SC_FILE_VER 1
 #define HV_FILE_VER 1
 #define CPU_FILE_VER 1
+#define QL_FILE_VER 2
+#define LC_FILE_VER 1
+#define DOWNLINK_FILE_VER 1
+#define L4_FILE_VER 1
 
 
 /*
@@ -114,11 +123,25 @@ typedef struct
 #define SC_PACKET_TYPE 'S'
 #define CPU_PACKET_TYPE 'P'
 #define TRAILER_PACKET_TYPE 'Q'
+#define SC_SUMMARY_PACKET_TYPE 'A'
+#define STATS_PACKET_TYPE 'X'
+#define LC_PACKET_TYPE 'Y'
+#define FLAGS_PACKET_TYPE 'F'
+#define DOWNLINK_ENTRY_TYPE 'E'
+#define CALIB_PACKET_TYPE 'K'
+#define L4_PACKET_TYPE 'Z'
 #define THERM_PACKET_VER 1
 #define HK_PACKET_VER 1
 #define HV_PACKET_VER 1
-#define SC_PACKET_VER 2
+#define SC_PACKET_VER 4
 #define CPU_PACKET_VER 2
+#define SC_SUMMARY_PACKET_VER 1
+#define STATS_PACKET_VER 1
+#define LC_PACKET_VER 1
+#define FLAGS_PACKET_VER 1
+#define DOWNLINK_ENTRY_VER 1
+#define CALIB_PACKET_VER 1
+#define L4_PACKET_VER 1
 
 /*
  * for the analog readout 
@@ -198,6 +221,156 @@ typedef struct
   ZYNQ_PACKET zynq_packet; /* variable size */
 } CPU_PACKET;
 
+/*
+ * number of trig_type values counted in the STATS_PACKET, TRIG_NONE to TRIG_OTHERS
+ */
+#define N_TRIG_TYPES 9
+
+/*
+ * value of a saturated pixel in the D1 raw data
+ */
+#define D1_SATURATION 255
+
+/**
+ * statistics of a ZYNQ_PACKET, stored in the CPU_RUN_QL file
+ * with the same pkt_num as the corresponding CPU_PACKET
+ * pixels are in the same order as the Zynq data
+ * 18842 bytes
+ */
+typedef struct
+{
+  CpuPktHeader stats_packet_header; /* 16 bytes */
+  CpuTimeStamp stats_time; /* 4 bytes */
+  uint8_t N1; /* 1 byte */
+  uint8_t N2; /* 1 byte */
+  uint16_t l1_trig_count[N_TRIG_TYPES]; /* number of D1 packets with each trig_type, 18 bytes */
+  uint16_t l2_trig_count[N_TRIG_TYPES]; /* number of D2 packets with each trig_type, 18 bytes */
+  uint32_t l3_trig_type; /* 4 bytes */
+  uint32_t hv_status; /* 4 bytes */
+  float d3_mean[N_OF_PIXEL_PER_PDM]; /* mean over the D3 frames, 9216 bytes */
+  uint32_t d3_max[N_OF_PIXEL_PER_PDM]; /* max over the D3 frames, 9216 bytes */
+  uint64_t ecasic_sum[N_OF_ECASIC_PER_PDM]; /* sum over the D3 frames, 48 bytes */
+  uint64_t pmt_sum[N_OF_ECASIC_PER_PDM * N_OF_PMT_PER_ECASIC]; /* sum over the D3 frames, 288 bytes */
+  uint32_t n_saturated_d1; /* number of D1 samples at D1_SATURATION, 4 bytes */
+  uint32_t n_saturated_pixels_d1; /* number of pixels saturated at least once in D1, 4 bytes */
+} STATS_PACKET;
+
+/*
+ * flags of a D1 or D2 block in the FLAGS_PACKET
+ */
+#define TRANSIENT_NONE 0x00
+#define TRANSIENT_EMPTY 0x01 /* block not stored in the packet */
+#define TRANSIENT_EXTENDED 0x02 /* at least a PMT worth of pixels above background in a frame */
+#define TRANSIENT_EXPANDING 0x04 /* lit area expanding quickly */
+#define TRANSIENT_ELVE_CANDIDATE 0x08 /* extended and expanding */
+#define TRANSIENT_SATURATED 0x10 /* D1 saturated pixels */
+
+/**
+ * classification of a D1 or D2 block by its fast transient
+ * 20 bytes
+ */
+typedef struct
+{
+  uint32_t trig_type; /* copied from the block, 4 bytes */
+  uint8_t flags; /* TRANSIENT_XXX, 1 byte */
+  uint8_t peak_frame; /* frame of the largest increase, 1 byte */
+  uint16_t extent; /* largest number of pixels above background in a frame, 2 bytes */
+  float expansion; /* fastest growth of the radius of the lit area, in pixels per frame, 4 bytes */
+  float peak; /* largest increase between frames, in units of the background fluctuation, 4 bytes */
+  float score; /* 0 to 1, higher is more interesting, 4 bytes */
+} TransientFlags;
+
+/**
+ * flag table of a ZYNQ_PACKET, stored in the CPU_RUN_QL file
+ * after the STATS_PACKET with the same pkt_num
+ * the first N1 and N2 entries are used
+ * 182 bytes
+ */
+typedef struct
+{
+  CpuPktHeader flags_packet_header; /* 16 bytes */
+  CpuTimeStamp flags_time; /* 4 bytes */
+  uint8_t N1; /* 1 byte */
+  uint8_t N2; /* 1 byte */
+  TransientFlags l1_flags[MAX_PACKETS_L1]; /* 80 bytes */
+  TransientFlags l2_flags[MAX_PACKETS_L2]; /* 80 bytes */
+} FLAGS_PACKET;
+
+/*
+ * size of the run_file field of the DOWNLINK_ENTRY
+ */
+#define DOWNLINK_RUN_FILE_SIZE 128
+
+/**
+ * entry of a DOWNLINK file, followed by its payload:
+ * a Z_DATA_TYPE_SCI_L1_V2 (level 1), a Z_DATA_TYPE_SCI_L2_V2 (level 2)
+ * or the STATS_PACKET of the CPU_PACKET (level 3)
+ * 154 bytes
+ */
+typedef struct
+{
+  CpuPktHeader entry_header; /* 16 bytes */
+  char run_file[DOWNLINK_RUN_FILE_SIZE]; /* name of the CPU_RUN_MAIN file, 128 bytes */
+  uint32_t run_pkt_num; /* pkt_num of the CPU_PACKET in the run, 4 bytes */
+  uint8_t level; /* 1, 2 or 3, 1 byte */
+  uint8_t block; /* index of the D1 or D2 block in the CPU_PACKET, 1 byte */
+  float score; /* from the FLAGS_PACKET, 4 bytes */
+} DOWNLINK_ENTRY;
+
+/**
+ * per-pixel calibration kept on board by CalibrationCache, and saved so that
+ * it is available after a restart
+ * pixels are in the same order as the Zynq data
+ * 18460 bytes
+ */
+typedef struct
+{
+  CpuPktHeader calib_packet_header; /* 16 bytes */
+  CpuTimeStamp calib_time; /* time of the last update, 4 bytes */
+  CpuTimeStamp gain_time; /* time of the S-curve analysis, 0 if none, 4 bytes */
+  uint32_t n_updates; /* number of packets in the background, 4 bytes */
+  float flat_field[N_OF_PIXEL_PER_PDM]; /* inverse of the relative gain, 0 for a bad pixel, 9216 bytes */
+  float background[N_OF_PIXEL_PER_PDM]; /* D3 counts per frame, 9216 bytes */
+} CALIB_PACKET;
+
+/*
+ * number of PMTs in the PDM
+ */
+#define N_OF_PMT_PER_PDM (N_OF_PMT_PER_ECASIC * N_OF_ECASIC_PER_PDM)
+
+/**
+ * light curve of a ZYNQ_PACKET, stored in the per-night CPU_RUN_LC file
+ * the sums of the D3 counts of the PDM and of each PMT, for each D3 frame (40.96 ms)
+ * PMTs are in the same order as the Zynq data
+ * 19488 bytes
+ */
+typedef struct
+{
+  CpuPktHeader lc_packet_header; /* 16 bytes */
+  CpuTimeStamp lc_time; /* 4 bytes */
+  TimeStamp_dual ts; /* copied from the D3 packet, 8 bytes */
+  uint32_t hv_status; /* copied from the D3 packet, 4 bytes */
+  uint64_t pdm_sum[N_OF_FRAMES_L3_V0]; /* 1024 bytes */
+  uint32_t pmt_sum[N_OF_FRAMES_L3_V0][N_OF_PMT_PER_PDM]; /* 18432 bytes */
+} LC_PACKET;
+
+/**
+ * D3 data of a ZYNQ_PACKET integrated over the 128 frames (5.24 s),
+ * stored in the per-night CPU_RUN_L4 file for trend analysis
+ * pixels are in the same order as the Zynq data
+ * 9264 bytes
+ */
+typedef struct
+{
+  CpuPktHeader l4_packet_header; /* 16 bytes */
+  CpuTimeStamp l4_time; /* 4 bytes */
+  TimeStamp_dual ts; /* copied from the D3 packet, 8 bytes */
+  uint32_t trig_type; /* copied from the D3 packet, 4 bytes */
+  uint8_t cathode_status[12]; /* copied from the D3 packet, 12 bytes */
+  uint32_t hv_status; /* copied from the D3 packet, 4 bytes */
+  uint32_t int_data[N_OF_PIXEL_PER_PDM]; /* sum of the D3 frames, 9216 bytes */
+} L4_PACKET;
+
 /**
  * CPU file to store one run 
  * shown here as demonstration only 
@@ -211,7 +384,8 @@ typedef struct
 } CPU_FILE;
 
 /**
- * SC packet to store S-curve from Zynq 
+ * SC packet to store S-curve from Zynq
+ * as written up to SC_PACKET_VER 2, kept to read older files
  * 9437220 bytes
  */
 typedef struct
@@ -223,17 +397,84 @@ typedef struct
   uint16_t sc_stop; /* 2 bytes */
   uint16_t sc_acc; /* 2 bytes */
   Z_DATA_TYPE_SCURVE_V1 sc_data; /* 9437192 bytes */
+} SC_PACKET_V2;
+
+/**
+ * one threshold step of an S-curve
+ * 9216 bytes
+ */
+typedef struct
+{
+  uint32_t int32_data[N_OF_PIXEL_PER_PDM]; /* 9216 bytes */
+} ScThresholdRow;
+
+/*
+ * size of the fixed part of the SC_PACKET, before the thresholds
+ */
+#define SC_PACKET_HEADER_SIZE 40
+
+/**
+ * SC packet to store S-curve from Zynq 
+ * only the N acquired thresholds are stored, in increasing order, and
+ * row i corresponds to the threshold sc_thresholds[i]. for a uniform scan
+ * this is sc_start + i * sc_step, while an adaptive scan is finer (sc_step)
+ * around the transitions than elsewhere
+ * variable size: 40 + N * 9218 bytes
+ * **NB: vectors themselves are not written to file, 
+ * just contents which are contiguous in memory** 
+ */
+typedef struct
+{
+  CpuPktHeader sc_packet_header; /* 16 bytes */
+  CpuTimeStamp sc_time; /* 4 bytes */
+  uint16_t sc_start; /* 2 bytes */
+  uint16_t sc_step; /* 2 bytes */
+  uint16_t sc_stop; /* 2 bytes */
+  uint16_t sc_acc; /* 2 bytes */
+  uint32_t N; /* 4 bytes */
+  ZynqBoardHeader zbh; /* 8 bytes */
+  std::vector<uint16_t> sc_thresholds; /* N * 2 bytes */
+  std::vector<ScThresholdRow> sc_data; /* N * 9216 bytes */
 } SC_PACKET;
 
+/*
+ * pixel flags of the SC_SUMMARY_PACKET
+ */
+#define SC_PIXEL_OK 0x00
+#define SC_PIXEL_DEAD 0x01 /* no counts at any threshold */
+#define SC_PIXEL_HOT 0x02 /* plateau well above the rest of the PDM */
+#define SC_PIXEL_NO_TRANSITION 0x04 /* no drop in counts over the scanned range */
+#define SC_PIXEL_EDGE 0x08 /* transition at the edge of the scanned range */
+
+/**
+ * summary of the S-curve analysis, stored after the SC_PACKET
+ * pixels are in the same order as the Zynq data
+ * 29980 bytes
+ */
+typedef struct
+{
+  CpuPktHeader sc_summary_packet_header; /* 16 bytes */
+  CpuTimeStamp sc_summary_time; /* 4 bytes */
+  uint16_t sc_start; /* 2 bytes */
+  uint16_t sc_step; /* 2 bytes */
+  uint16_t sc_stop; /* 2 bytes */
+  uint16_t sc_acc; /* 2 bytes */
+  float half_point[N_OF_PIXEL_PER_PDM]; /* DAC of the 50% point, 9216 bytes */
+  float width[N_OF_PIXEL_PER_PDM]; /* width of the transition in DAC, 9216 bytes */
+  float pedestal[N_OF_PIXEL_PER_PDM]; /* DAC of the steepest drop, 9216 bytes */
+  uint8_t flags[N_OF_PIXEL_PER_PDM]; /* SC_PIXEL_XXX, 2304 bytes */
+} SC_SUMMARY_PACKET;
+
 /**
  * SC file to store a single S-curve
  * shown here as demonstration only 
- * 9437244 bytes (~9 MB) 
+ * variable size (~9 MB for all 1024 thresholds) 
  */
 typedef struct
 {
   CpuFileHeader cpu_file_header; /* 12 bytes */
-  SC_PACKET scurve_packet; /* 9437220 bytes */
+  SC_PACKET scurve_packet; /* variable size */
+  SC_SUMMARY_PACKET scurve_summary_packet; /* 29980 bytes */
   CpuFileTrailer cpu_file_trailer; /* 12 bytes */
 } SC_FILE;
 
@@ -0,0 +1,96 @@
+#ifndef _PIXEL_MAP_H
+#define _PIXEL_MAP_H
+
+/*
+ * geometry of the PDM focal surface
+ *-----------------------------------*
+ * mapping between the pixel order of the Zynq data,
+ * (ecasic * N_OF_PMT_PER_ECASIC + pmt) * N_OF_PIXELS_PER_PMT + pixel,
+ * and the 48 x 48 focal surface, as in DeadPixelMask.txt:
+ * the ecasic gives the row of PMTs and the pmt the column of PMTs,
+ * and the pixel is row major inside the PMT
+ * the tables are generated at compile time
+ */
+
+#include <stdint.h>
+
+#include "minieuso_pdmdata.h"
+
+/*
+ * size of the focal surface and of a PMT, in pixels
+ */
+#define FOCAL_SURFACE_SIZE 48
+#define PMT_SIZE 8
+
+/**
+ * row of a pixel of the Zynq data in the focal surface
+ */
+constexpr int PixelRow(int p) {
+  return (p / (N_OF_PMT_PER_ECASIC * N_OF_PIXELS_PER_PMT)) * PMT_SIZE
+    + (p % N_OF_PIXELS_PER_PMT) / PMT_SIZE;
+}
+
+/**
+ * column of a pixel of the Zynq data in the focal surface
+ */
+constexpr int PixelCol(int p) {
+  return ((p / N_OF_PIXELS_PER_PMT) % N_OF_PMT_PER_ECASIC) * PMT_SIZE
+    + (p % N_OF_PIXELS_PER_PMT) % PMT_SIZE;
+}
+
+/**
+ * index of a pixel of the Zynq data in the focal surface, row major
+ */
+constexpr int FocalIndex(int p) {
+  return PixelRow(p) * FOCAL_SURFACE_SIZE + PixelCol(p);
+}
+
+/**
+ * index in the Zynq data of the pixel at a row and column of the focal surface
+ */
+constexpr int ZynqIndex(int row, int col) {
+  return ((row / PMT_SIZE) * N_OF_PMT_PER_ECASIC + col / PMT_SIZE) * N_OF_PIXELS_PER_PMT
+    + (row % PMT_SIZE) * PMT_SIZE + col % PMT_SIZE;
+}
+
+/*
+ * compile time sequence of indices, built by halves to keep
+ * the template recursion shallow
+ */
+template <int... I> struct PixelIndexSeq {};
+template <class S1, class S2> struct PixelIndexConcat;
+template <int... I1, int... I2>
+struct PixelIndexConcat<PixelIndexSeq<I1...>, PixelIndexSeq<I2...>> {
+  typedef PixelIndexSeq<I1..., (int)sizeof...(I1) + I2...> type;
+};
+template <int N>
+struct MakePixelIndexSeq : PixelIndexConcat<typename MakePixelIndexSeq<N / 2>::type,
+					    typename MakePixelIndexSeq<N - N / 2>::type> {};
+template <> struct MakePixelIndexSeq<0> { typedef PixelIndexSeq<> type; };
+template <> struct MakePixelIndexSeq<1> { typedef PixelIndexSeq<0> type; };
+
+template <class S> struct PixelMapTable;
+/**
+ * lookup tables of the focal surface geometry
+ * focal_index[p] is the index in the focal surface of the pixel p of the Zynq data,
+ * and zynq_index[i] the pixel of the Zynq data at the index i of the focal surface
+ */
+template <int... I>
+struct PixelMapTable<PixelIndexSeq<I...>> {
+  static constexpr uint16_t focal_index[sizeof...(I)] = {(uint16_t)FocalIndex(I)...};
+  static constexpr uint16_t zynq_index[sizeof...(I)] = {(uint16_t)ZynqIndex(I / FOCAL_SURFACE_SIZE,
+									     I % FOCAL_SURFACE_SIZE)...};
+};
+template <int... I>
+constexpr uint16_t PixelMapTable<PixelIndexSeq<I...>>::focal_index[sizeof...(I)];
+template <int... I>
+constexpr uint16_t PixelMapTable<PixelIndexSeq<I...>>::zynq_index[sizeof...(I)];
+
+typedef PixelMapTable<MakePixelIndexSeq<N_OF_PIXEL_PER_PDM>::type> PixelMap;
+
+static_assert(FOCAL_SURFACE_SIZE * FOCAL_SURFACE_SIZE == N_OF_PIXEL_PER_PDM, "focal surface size");
+static_assert(PixelMap::zynq_index[PixelMap::focal_index[N_OF_PIXEL_PER_PDM - 1]] == N_OF_PIXEL_PER_PDM - 1,
+	      "focal surface mapping");
+
+#endif
+/* _PIXEL_MAP_H */